@@ -16,11 +16,147 @@ CONFIG_REQUIRE = {'name', 'id', 'launch', 'version'}
 SEMVER_MULTIPLIER = 100
 
 
+# Lua tokens, for stripping asserts from release packages
+LUA_TOKEN = re.compile(r'''
+    (?P<space>\s+)
+  | (?P<comment>--(?:\[(?P<cq>=*)\[[\s\S]*?\](?P=cq)\]|[^\n]*))
+  | (?P<long>\[(?P<lq>=*)\[[\s\S]*?\](?P=lq)\])
+  | (?P<string>"(?:\\[\s\S]|[^"\\\n])*"|'(?:\\[\s\S]|[^'\\\n])*')
+  | (?P<number>0[xX][0-9a-fA-F.]+(?:[pP][+-]?\d+)?
+      |(?:\d+\.?\d*|\.\d+)(?:[eE][+-]?\d+)?)
+  | (?P<name>[A-Za-z_]\w*)
+  | (?P<op>\.\.\.|\.\.|==|~=|<=|>=|::|//|<<|>>|[^\s\w])
+''', re.VERBOSE)
+
+LUA_KEYWORDS = {
+    'and', 'break', 'do', 'else', 'elseif', 'end', 'false', 'for',
+    'function', 'goto', 'if', 'in', 'local', 'nil', 'not', 'or', 'repeat',
+    'return', 'then', 'true', 'until', 'while',
+}
+
+# Tokens after which a name starts a new statement
+STATEMENT_END = {
+    ';', 'then', 'do', 'else', 'repeat', 'end', 'break', 'true', 'false',
+    'nil', '...', ')', ']', '}', '::',
+}
+
+RELEASE_SKIP = {'core/env/strict.lua'}
+RELEASE_BUILD = b'''-- Build settings, generated for release packages
+return {
+  release = true,
+}
+'''
+
+
 class CLIError(Exception):
     pass
 
 
-def copy_dir(src, dst, tpl_context, skip_dirs=None, match_dirs=None):
+def lua_tokens(source):
+    tokens = []
+    pos = 0
+    while pos < len(source):
+        match = LUA_TOKEN.match(source, pos)
+        if not match:
+            raise CLIError('Cannot tokenize Lua source at %d' % pos)
+        kind = match.lastgroup
+        if kind not in ('space', 'comment'):
+            value = match.group()
+            if kind == 'name' and value in LUA_KEYWORDS:
+                kind = 'keyword'
+            elif kind == 'long':
+                kind = 'string'
+            tokens.append((kind, value, match.start(), match.end()))
+        pos = match.end()
+    return tokens
+
+
+def strip_asserts(source):
+    """Removes precondition `assert(cond)` statements from Lua source
+
+    Only asserts used as statements are changed, asserts whose value is used
+    stay. Asserts without a message are removed, asserts with a message
+    (checks of input or usage) become `if not (cond) then assert(false,
+    message) end`, so the message is only built when the check fails.
+    Rewritten calls keep their newlines so line numbers in errors stay the
+    same. Asserts must not have side effects.
+    """
+    tokens = lua_tokens(source)
+    cuts = []
+    i = 0
+    while i < len(tokens):
+        kind, value = tokens[i][:2]
+        if (kind != 'name' or value != 'assert' or
+                i + 1 >= len(tokens) or tokens[i + 1][1] != '('):
+            i += 1
+            continue
+
+        prev = tokens[i - 1] if i > 0 else None
+        statement = (prev is None or prev[1] in STATEMENT_END or
+                     prev[0] in ('name', 'number', 'string'))
+
+        # Find the closing parenthesis and the comma before a message
+        depth = 0
+        comma = None
+        j = i + 1
+        while j < len(tokens):
+            if tokens[j][1] in ('(', '[', '{'):
+                depth += 1
+            elif tokens[j][1] in (')', ']', '}'):
+                depth -= 1
+                if depth == 0:
+                    break
+            elif tokens[j][1] == ',' and depth == 1 and comma is None:
+                comma = j
+            j += 1
+        if j == len(tokens):
+            raise CLIError('Unbalanced assert call')
+
+        after = tokens[j + 1] if j + 1 < len(tokens) else None
+        if after and (after[1] in ('.', ':', '[', '(', '{') or
+                      after[0] == 'string'):
+            statement = False
+
+        if not statement:
+            i += 1
+            continue
+
+        start, end = tokens[i][2], tokens[j][3]
+        if comma is None:
+            text = '\n' * source.count('\n', start, end)
+        else:
+            cond = source[tokens[i + 1][3]:tokens[comma][2]]
+            message = source[tokens[comma][3]:tokens[j][2]]
+            text = 'if not (%s) then assert(false,%s) end' % (cond, message)
+        cuts.append((start, end, text))
+        i = j + 1
+
+    parts = []
+    pos = 0
+    for start, end, text in cuts:
+        parts.append(source[pos:start])
+        parts.append(text)
+        pos = end
+    parts.append(source[pos:])
+    return ''.join(parts)
+
+
+def lua_transform(prefix, release):
+    """Returns a `copy_dir` transform for framework Lua modules"""
+    def transform(rel, data):
+        module = '/'.join([prefix] + rel.split(os.sep))
+        if not release or not module.endswith('.lua'):
+            return data
+        if module in RELEASE_SKIP:
+            return None
+        if module == 'core/env/build.lua':
+            return RELEASE_BUILD
+        return strip_asserts(data.decode('utf-8')).encode('utf-8')
+    return transform
+
+
+def copy_dir(src, dst, tpl_context, skip_dirs=None, match_dirs=None,
+             transform=None):
     for path, _, files in os.walk(src):
         if skip_dirs and path != src:
             if any((os.path.normpath(s) in path for s in skip_dirs)):
@@ -46,6 +182,20 @@ def copy_dir(src, dst, tpl_context, skip_dirs=None, match_dirs=None):
                                    output_encoding='utf-8',
                                    imports=['import os, os.path as path'])
                     w.write(tpl.render(**tpl_context))
+            elif transform:
+                # Compare contents, the output differs between build modes
+                with open(file, 'rb') as r:
+                    data = transform(rel, r.read())
+                if data is None:
+                    if os.path.exists(target):
+                        os.remove(target)
+                    continue
+                if os.path.exists(target):
+                    with open(target, 'rb') as r:
+                        if r.read() == data:
+                            continue
+                with open(target, 'wb') as w:
+                    w.write(data)
             elif (not os.path.exists(target) or
                     os.path.getmtime(file) > os.path.getmtime(target)):
                 shutil.copyfile(file, target)
@@ -133,8 +283,8 @@ def install_android():
     gradle('installDebug')
 
 
-def setup(platform):
-    print('Setup platform:', platform)
+def setup(platform, release=False):
+    print('Setup platform:', platform, '(release)' if release else '(debug)')
 
     # App config
     try:
@@ -194,22 +344,25 @@ def setup(platform):
     context = {
         'app': config,
         'build_path': build_path,
+        'release': release,
     }
 
     copy_dir('components', os.path.join(package_path, 'components'), context)
-    copy_dir(core_path, os.path.join(package_path, 'core'), context)
+    copy_dir(core_path, os.path.join(package_path, 'core'), context,
+             transform=lua_transform('core', release))
     copy_dir(platform_native_path, os.path.join(build_path, 'native'), context)
     copy_dir(os.path.join(platform_base_path),
              os.path.join(package_path, 'platform'), context,
              skip_dirs=[platform_native_path],
-             match_dirs=[platform_path, platform_common_path])
+             match_dirs=[platform_path, platform_common_path],
+             transform=lua_transform('platform', release))
 
     context['native_modules'] = next(os.walk(native_path))[1]
     copy_dir(template_path, build_path, context)
 
 
-def build(platform):
-    setup(platform)
+def build(platform, release=False):
+    setup(platform, release)
     print('Build platform:', platform)
 
     # Platform build hook
@@ -218,8 +371,8 @@ def build(platform):
         platform_build()
 
 
-def install(platform):
-    setup(platform)
+def install(platform, release=False):
+    setup(platform, release)
     print('Install platform:', platform)
 
     # Platform build hook
@@ -240,16 +393,22 @@ def main():
     cmd.set_defaults(func=setup)
     cmd.add_argument('platforms', help='platforms',
                      nargs='+', choices=PLATFORMS)
+    cmd.add_argument('--release', help='strip asserts and strict globals',
+                     action='store_true')
 
     cmd = command.add_parser('build', help='build project for target')
     cmd.set_defaults(func=build)
     cmd.add_argument('platforms', help='platforms',
                      nargs='+', choices=PLATFORMS)
+    cmd.add_argument('--release', help='strip asserts and strict globals',
+                     action='store_true')
 
     cmd = command.add_parser('install', help='install project on target')
     cmd.set_defaults(func=install)
     cmd.add_argument('platforms', help='platforms',
                      nargs='+', choices=PLATFORMS)
+    cmd.add_argument('--release', help='strip asserts and strict globals',
+                     action='store_true')
 
     args = parser.parse_args()
     if hasattr(args, 'func'):
@@ -258,7 +417,7 @@ def main():
                 if 'all' in args.platforms:
                     args.platforms = PLATFORMS - {'all'}
                 for p in args.platforms:
-                    args.func(platform=p)
+                    args.func(platform=p, release=args.release)
             else:
                 args.func(args)
         except CLIError as e:
@@ -2,7 +2,15 @@
 <manifest xmlns:android="http://schemas.android.com/apk/res/android" package="${ app['id'] }">
   <application android:label="${ app['name'] }">
     <meta-data android:name="entry" android:value="components.${ app['launch'] }" />
+    % if not release and app['android'].get('jit_trace'):
+    <meta-data android:name="jit_trace" android:value="true" />
+    % endif
+    % if app['android'].get('config_changes'):
+    <activity android:name="com.slick.core.SlickActivity"
+      android:configChanges="${ '|'.join(app['android']['config_changes']) }">
+    % else:
     <activity android:name="com.slick.core.SlickActivity">
+    % endif
       <intent-filter>
         <action android:name="android.intent.action.MAIN" />
         <category android:name="android.intent.category.LAUNCHER" />
@@ -0,0 +1,102 @@
+-- Least recently used cache bounded by entry count and total cost
+--
+-- Entries are kept in a doubly linked list, most recently used first. When a
+-- bound is exceeded the least recently used entries are evicted and passed
+-- to `evict(key, value)`.
+local Cache = {}
+
+
+function Cache.new(options)
+  options = options or {}
+  local cache = {
+    max = options.max or math.huge,
+    max_cost = options.max_cost or math.huge,
+    evict = options.evict,
+    entries = {},
+    n = 0,
+    cost = 0,
+    evicted = 0,
+  }
+  -- Sentinel, `head.next` is the most and `head.prev` the least recent
+  cache.head = {}
+  cache.head.next, cache.head.prev = cache.head, cache.head
+  return setmetatable(cache, Cache)
+end
+
+
+local function unlink(c, entry)
+  entry.prev.next = entry.next
+  entry.next.prev = entry.prev
+  c.entries[entry.key] = nil
+  c.n = c.n - 1
+  c.cost = c.cost - entry.cost
+end
+
+
+local function link(c, entry)
+  local head = c.head
+  entry.prev, entry.next = head, head.next
+  head.next.prev = entry
+  head.next = entry
+  c.entries[entry.key] = entry
+  c.n = c.n + 1
+  c.cost = c.cost + entry.cost
+end
+
+
+local function evict_lru(c)
+  local entry = c.head.prev
+  unlink(c, entry)
+  c.evicted = c.evicted + 1
+  if c.evict then c.evict(entry.key, entry.value) end
+end
+
+
+-- Evicts entries until at most `max` entries with a total cost of at most
+-- `max_cost` are left, defaults to the cache bounds
+function Cache.trim(c, max_cost, max)
+  max_cost = max_cost or c.max_cost
+  max = max or c.max
+  while c.n > 0 and (c.n > max or c.cost > max_cost) do
+    evict_lru(c)
+  end
+end
+
+
+function Cache.put(c, key, value, cost)
+  local entry = c.entries[key]
+  if entry then unlink(c, entry) end
+  link(c, {key = key, value = value, cost = cost or 1})
+  Cache.trim(c)
+end
+
+
+function Cache.get(c, key)
+  local entry = c.entries[key]
+  if not entry then return nil end
+  unlink(c, entry)
+  link(c, entry)
+  return entry.value
+end
+
+
+-- Removes the entry for `key` without evicting it and returns its value
+function Cache.take(c, key)
+  local entry = c.entries[key]
+  if not entry then return nil end
+  unlink(c, entry)
+  return entry.value
+end
+
+
+function Cache.clear(c)
+  Cache.trim(c, 0, 0)
+end
+
+
+function Cache:__tostring()
+  return string.format('Cache(n: %d, cost: %g)', self.n, self.cost)
+end
+
+
+return Cache
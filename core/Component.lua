@@ -3,12 +3,15 @@ local platform = require('platform')
 local Observable = require('core.Observable')
 local IndexRecorder = require('core.IndexRecorder')
 local Dispatcher = require('core.Dispatcher')
+local Style = require('core.Style')
 
 local Component = {
   instances = setmetatable({}, {__mode = 'v'}),
   cache = {},
 }
 
+local NO_ARGS = {}
+
 local loader_globals = {
   scope = IndexRecorder.new('scope'),
   attr = IndexRecorder.new('attr'),
@@ -27,6 +30,90 @@ local function loader(what, definition)
 end
 
 
+-- Compiles controller watches into a binding plan once per definition:
+-- attr watchers as a list and `id` listeners indexed by child id
+local function compile_plan(definition)
+  local plan = {watchers = {}, listeners = {}}
+  local watched = {}
+
+  for ir, f in pairs(definition.controller) do
+    if getmetatable(ir) ~= IndexRecorder then goto continue end
+    local info = IndexRecorder.info(ir)
+
+    if info.type == 'attr' then
+      if #ir ~= 1 then
+        error('Invalid attr watch: ' .. IndexRecorder.value(ir))
+      end
+      if watched[ir[1]] then
+        error('Duplicate attr watch found: ' .. IndexRecorder.value(ir))
+      end
+      watched[ir[1]] = true
+      table.insert(plan.watchers, {name = ir[1], func = f})
+    elseif info.type == 'id' then
+      if #ir >= 3 then
+        error('Invalid listener for: ' .. IndexRecorder.value(ir))
+      end
+      local listeners = plan.listeners[ir[1]]
+      if not listeners then
+        listeners = {}
+        plan.listeners[ir[1]] = listeners
+      end
+      if #ir == 1 then
+        if type(f) ~= 'table' then
+          error('Expected listener table for: ' .. IndexRecorder.value(ir))
+        end
+        for event, listener in pairs(f) do
+          table.insert(listeners, {event = event, func = listener})
+        end
+      else
+        if type(f) ~= 'function' then
+          error('Expected listener function for: ' .. IndexRecorder.value(ir))
+        end
+        table.insert(listeners, {event = ir[2], func = f})
+      end
+    elseif info.type == 'scope' then
+      error('Scope watch not supported')
+    else
+      error('Invalid watch type: ' .. info.type)
+    end
+    :: continue ::
+  end
+  return plan
+end
+
+
+-- Arg binding descriptors, resolved once per args table
+local arg_plans = setmetatable({}, {__mode = 'k'})
+
+local function plan_args(args)
+  local plan = arg_plans[args]
+  if plan then return plan end
+
+  plan = {}
+  for name, arg in pairs(args) do
+    local binding = {name = name, value = arg}
+    if getmetatable(arg) == IndexRecorder then
+      local info = IndexRecorder.info(arg)
+      if info.type == 'scope' or info.type == 'attr' or info.type == 'loop' then
+        binding = {
+          name = name,
+          source = info.type,
+          path = arg,
+          depth = #arg - 1,
+          key = arg[#arg],
+          init = info.type == 'scope' and info.init or nil,
+        }
+      else
+        assert(info.type == 'ui' or info.type == 'component', info.type)
+      end
+    end
+    table.insert(plan, binding)
+  end
+  arg_plans[args] = plan
+  return plan
+end
+
+
 function Component.load_definition(name)
   assert(type(name) == 'string')
 
@@ -48,39 +135,109 @@ function Component.load_definition(name)
 
   local loader_env = {
     view = loader('view', definition),
-    controller = loader('controller', definition)
+    controller = loader('controller', definition),
+    style = loader('style', definition),
   }
 
   bindfenv(f, loader_env, loader_globals)()
+
+  -- Opt-in instance pool, `['$pool'] = max_size`. Free instances are kept
+  -- per args table, reused ones run their constructor again with the new
+  -- arguments, after `$reset` cleaned up the previous use.
+  local pool_size = definition.controller['$pool']
+  if pool_size then
+    assert(type(pool_size) == 'number', 'Expected number for $pool')
+    definition.pool = {
+      max = pool_size,
+      n = 0,
+      free = {},
+      hits = 0,
+      misses = 0,
+      dropped = 0,
+    }
+  end
+
+  definition.plan = compile_plan(definition)
   Component.cache[path] = definition
   return definition
 end
 
 
+local function acquire(definition, id, args)
+  local pool = definition.pool
+  local free = pool.free[args]
+  local component = free and table.remove(free)
+  if not component then
+    pool.misses = pool.misses + 1
+    return
+  end
+  if #free == 0 then pool.free[args] = nil end
+
+  pool.hits = pool.hits + 1
+  pool.n = pool.n - 1
+  component.id = id
+  return component
+end
+
+
+-- Module name of a `ui.X` or `component.X` reference in a view
+local function reference_name(ir)
+  local info = IndexRecorder.info(ir)
+  local path = table.concat(ir, '.')
+  if info.type == 'ui' then
+    return 'platform.' .. platform.name .. '.ui.' .. path
+  elseif info.type == 'component' then
+    return 'components.' .. path
+  end
+  error('Invalid component: ' .. path)
+end
+
+
+-- Loads the definition of `name` and of the components its view refers to,
+-- so that building them later does not load any file
+function Component.preload(name)
+  local path = name:gsub('%.', '/') .. '.lua'
+  if Component.cache[path] then return end
+  local definition = Component.load_definition(name)
+
+  local function walk(view)
+    for _, v in ipairs(view) do
+      if getmetatable(v) == IndexRecorder and rawget(v, 1) then
+        local info = IndexRecorder.info(v)
+        if info.type == 'ui' or info.type == 'component' then
+          Component.preload(reference_name(v))
+          walk(info.args)
+        end
+      elseif type(v) == 'table' and not getmetatable(v) then
+        walk(v)
+      end
+    end
+  end
+  walk(definition.view)
+end
+
+
 function Component.get(component, id, args)
   assert(getmetatable(component) ~= Component)
   if getmetatable(component) == IndexRecorder then
     assert(not id and not args)
     local info = IndexRecorder.info(component)
-    local path = table.concat(component, '.')
-    local prefix
+    return Component.get(reference_name(component), info.id, info.args[1])
+  end
 
-    if info.type == 'ui' then
-      prefix = 'platform.' .. platform.name .. '.ui.'
-    elseif info.type == 'component' then
-      prefix = 'components.'
-    else
-      error('Invalid component: ' .. path)
-    end
-    return Component.get(prefix .. path, info.id, info.args[1])
+  args = args or NO_ARGS
+  local definition = Component.load_definition(component)
+  if definition.pool then
+    local component = acquire(definition, id, args)
+    if component then return component end
   end
 
   local attr = Observable.new({})
   local scope = Observable.new({})
   local component = {
     id = id,
-    args = args or {},
-    definition = Component.load_definition(component),
+    args = args,
+    definition = definition,
     attr = attr,
     scope = scope,
     env = {attr = attr, scope = scope},
@@ -89,20 +246,82 @@ function Component.get(component, id, args)
 end
 
 
+-- Pooled components bind args through their own attr slots, kept in sync
+-- with the source slot, so bindings inside the pooled subtree stay valid when
+-- the component is handed out again with other args
+local function link_slot(component, name, slot)
+  local own = Observable.index(component.attr, name, true)
+  local scope = component.scope
+  local up_id, up, down_id, down
+
+  down_id, down = Observable.watch(slot, nil, function(v, idx)
+    if idx == nil then Observable.set(own, v, up_id) end
+  end, scope)
+  up_id, up = Observable.watch(own, nil, function(v, idx)
+    if idx == nil then Observable.set(slot, v, down_id) end
+  end, scope)
+
+  table.insert(rawget(scope, '$links'), {slot, down, own, up})
+  Observable.set(own, Observable.unwrap(slot), up_id)
+end
+
+
+local function bind_slot(component, name, slot)
+  if component.definition.pool then
+    link_slot(component, name, slot)
+  else
+    Observable.set_slot(component.attr, name, slot)
+  end
+end
+
+
+local function unlink_slots(scope)
+  for _, link in ipairs(rawget(scope, '$links') or {}) do
+    Observable.unwatch(link[1], nil, link[2])
+    Observable.unwatch(link[3], nil, link[4])
+  end
+  rawset(scope, '$links', {})
+end
+
+
+-- Computed values created by the controller stop following their sources
+local function dispose_computeds(scope)
+  for _, c in ipairs(rawget(scope, '$computeds') or {}) do
+    Observable.dispose(c)
+  end
+  rawset(scope, '$computeds', {})
+end
+
+
+-- Listeners bound by the parent go back to the clone cache with the scope
+local function release_listeners(scope)
+  for _, list in pairs(rawget(scope, '$listeners') or {}) do
+    for _, listener in ipairs(list) do releasefenv(listener) end
+  end
+end
+
+
 function Component.new(component, parent, ...)
   if getmetatable(component) ~= Component then
     component = Component.get(component)
   end
 
-  table.insert(Component.instances, component)
   local attr, scope = component.attr, component.scope
+  local pooled = rawget(scope, '$pooled')
+  if pooled then
+    rawset(scope, '$pooled', nil)
+  else
+    table.insert(Component.instances, component)
+    rawset(scope, '$component', component)
+    rawset(scope, '$watchers', {attr = {}})
+    rawset(scope, '$dispatch', {})
+    rawset(scope, '$links', {})
+    rawset(scope, '$computeds', {})
+  end
 
   rawset(scope, '$parent', parent)
-  rawset(scope, '$component', component)
   rawset(scope, '$id', component.id)
   rawset(scope, '$listeners', {})
-  rawset(scope, '$watchers', {attr = {}})
-  rawset(scope, '$dispatch', {})
 
   function component.env.trigger(event_name, ...)
     local listeners = scope['$listeners'][event_name]
@@ -114,103 +333,73 @@ function Component.new(component, parent, ...)
 
   -- Init component attrs from args
   if parent then
-    for name, arg in pairs(component.args) do
-      if getmetatable(arg) ~= IndexRecorder then
-        attr[name] = arg
+    for _, binding in ipairs(plan_args(component.args)) do
+      local name, source = binding.name, binding.source
+      if not source then
+        attr[name] = binding.value
         goto continue
       end
 
       -- Bind attr
-      local info = IndexRecorder.info(arg)
-      local source =
-        (info.type == 'scope' and parent.scope) or
-        (info.type == 'attr' and parent.attr) or
-        (info.type == 'loop' and (scope['$loop'] or {})) or nil
-
-      if source then
-        source = table.vivify(source, arg, #arg - 1)
-        if Observable.is_observable(source) then
-          -- `source` is an Observable table
-          local slot = Observable.index(source, arg[#arg], true)
-          Observable.set_slot(attr, name, slot)
-
-          -- Bind initial value
-          if info.init ~= nil and info.type == 'scope' then
-            attr[name] = info.init
-          end
-        else
-          -- `source` is a plain table that may contain slots
-          local v = source[arg[#arg]]
-          if Observable.is_observable(v) then
-            Observable.set_slot(attr, name, v)
-          else
-            attr[name] = v
-          end
+      source =
+        (source == 'scope' and parent.scope) or
+        (source == 'attr' and parent.attr) or
+        (scope['$loop'] or {})
+      if binding.depth > 0 then
+        source = table.vivify(source, binding.path, binding.depth)
+      end
+
+      if Observable.is_observable(source) then
+        -- `source` is an Observable table
+        local slot = Observable.index(source, binding.key, true)
+        bind_slot(component, name, slot)
+
+        -- Bind initial value
+        if binding.init ~= nil then
+          attr[name] = binding.init
         end
       else
-        assert(info.type == 'ui' or info.type == 'component', info.type)
-        attr[name] = arg
+        -- `source` is a plain table that may contain slots
+        local v = source[binding.key]
+        if Observable.is_observable(v) then
+          bind_slot(component, name, v)
+        else
+          attr[name] = v
+        end
       end
       :: continue ::
     end
   end
 
-  -- Register attr watchers
-  for ir, watcher in pairs(component.controller) do
-    if getmetatable(ir) ~= IndexRecorder then goto continue end
-    local info = IndexRecorder.info(ir)
-
-    if info.type == 'attr' then
-      if #ir ~= 1 then
-        error('Invalid attr watch: ' .. IndexRecorder.value(attr))
-      end
-      local attr_name = ir[1]
-      if scope['$watchers'].attr[attr_name] then
-        error('Duplicate attr watch found: ' .. IndexRecorder.value(attr))
-      end
-      watcher = bindfenv(watcher, component.env, true)
-      local id = Observable.watch(attr, attr_name, watcher)
-      scope['$watchers'].attr[attr_name] = {func = watcher, id = id}
-    elseif info.type == 'scope' then
-      error('Scope watch not supported')
-    elseif info.type ~= 'id' then
-      error('Invalid watch type: ' .. info.type)
+  -- Register attr watchers, pooled components keep theirs on own slots
+  if not pooled then
+    local watchers = scope['$watchers'].attr
+    for _, w in ipairs(component.plan.watchers) do
+      local watcher = bindfenv(w.func, component.env, true)
+      local id = Observable.watch(attr, w.name, watcher)
+      watchers[w.name] = {func = watcher, id = id}
     end
-    :: continue ::
   end
 
-  -- Register event listeners
-  if parent then
-    local parent_controller = parent.scope['$component'].controller
-    for ir, listener in pairs(parent_controller or {}) do
-      if getmetatable(ir) ~= IndexRecorder then goto continue end
-      local info = IndexRecorder.info(ir)
-      if info.type ~= 'id' then goto continue end
-
-      if #ir >= 3 then
-        error('Invalid listener for: ' .. IndexRecorder.value(id))
+  -- Register event listeners aimed at this child by the parent
+  local parent_plan = parent and parent.plan
+  local listeners = parent_plan and parent_plan.listeners[component.id]
+  if listeners then
+    local events = rawget(scope, '$listeners')
+    for _, l in ipairs(listeners) do
+      local list = events[l.event]
+      if not list then
+        list = {}
+        events[l.event] = list
       end
-
-      if ir[1] ~= component.id then goto continue end
-      if #ir == 1 then
-        if type(listener) ~= 'table' then
-          error('Expected listener table for: ' .. IndexRecorder.value(id))
-        end
-        for event, f in pairs(listener) do
-          local listeners = table.vivify(scope, {'$listeners', event})
-          table.insert(listeners, bindfenv(f, parent.env, true))
-        end
-      else
-        if type(listener) ~= 'function' then
-          error('Expected listener function for: ' .. id)
-        end
-        local listeners = table.vivify(scope, {'$listeners', ir[2]})
-        table.insert(listeners, bindfenv(listener, parent.env, true))
-      end
-      :: continue ::
+      table.insert(list, bindfenv(l.func, parent.env, true))
     end
   end
 
+  if pooled then
+    return component, component.element
+  end
+
   local controller = component.controller
   local new = controller and controller['$new']
   if new then
@@ -224,7 +413,7 @@ function Component.init(component, ...)
   local controller = component.controller
   local constructor = controller and controller[1]
   if constructor then
-    bindfenv(constructor, component.env, true)(...)
+    callfenv(constructor, component.env, true, ...)
   end
 end
 
@@ -232,6 +421,13 @@ end
 function Component.build(component, parent, ...)
   local component, element = Component.new(component, parent, ...)
 
+  -- Pooled components are handed out already built, styled by the new parent
+  if component.element then
+    Style.apply(component)
+    Component.init(component, ...)
+    return component, element
+  end
+
   -- Build view using Panel
   if type(component.view) == 'table' and #component.view > 0 then
     local panel = 'platform.' .. platform.name .. '.ui.Panel'
@@ -245,6 +441,7 @@ function Component.build(component, parent, ...)
   assert(element)
   component.element = element
   rawset(component.scope, '$element', element)
+  Style.apply(component)
 
   -- Platform specific build hook
   if platform.build then
@@ -256,24 +453,131 @@ function Component.build(component, parent, ...)
 end
 
 
+function Component.release(component)
+  local pool = component.definition.pool
+  if not pool or pool.n >= pool.max then
+    if pool then pool.dropped = pool.dropped + 1 end
+    Component.destroy(component)
+    return false
+  end
+
+  -- Detach from parent, keeping the element and the built subtree
+  local scope = component.scope
+  unlink_slots(scope)
+  Style.detach(component)
+  rawset(scope, '$parent', nil)
+  release_listeners(scope)
+  dispose_computeds(scope)
+  rawset(scope, '$listeners', {})
+  scope['$loop'] = nil
+
+  local reset = component.controller['$reset']
+  if reset then
+    callfenv(reset, component.env, true)
+  end
+
+  local free = pool.free[component.args]
+  if not free then
+    free = {}
+    pool.free[component.args] = free
+  end
+  table.insert(free, component)
+  rawset(scope, '$pooled', true)
+  pool.n = pool.n + 1
+  return true
+end
+
+
+function Component.pool_stats()
+  local stats = {}
+  for _, definition in pairs(Component.cache) do
+    local pool = definition.pool
+    if pool then
+      local total = pool.hits + pool.misses
+      stats[definition.name] = {
+        size = pool.n,
+        max = pool.max,
+        hits = pool.hits,
+        misses = pool.misses,
+        dropped = pool.dropped,
+        hit_rate = total > 0 and pool.hits / total or 0,
+      }
+    end
+  end
+  return stats
+end
+
+
+-- Pauses the watchers of `component` and its children while it is hidden,
+-- changes meanwhile are applied on `Component.resume`. Controllers with
+-- children of their own pass it on in `$suspend` and `$resume`.
+function Component.suspend(component)
+  local scope = component.scope
+  if Observable.is_suspended(scope) then return end
+  Observable.suspend(scope)
+
+  if scope['$panel'] then
+    Component.suspend(scope['$panel'])
+  end
+
+  local controller = component.controller
+  if controller and controller['$suspend'] then
+    callfenv(controller['$suspend'], component.env, true)
+  end
+end
+
+
+function Component.resume(component)
+  local scope = component.scope
+  if not Observable.is_suspended(scope) then return end
+  Observable.resume(scope)
+
+  if scope['$panel'] then
+    Component.resume(scope['$panel'])
+  end
+
+  local controller = component.controller
+  if controller and controller['$resume'] then
+    callfenv(controller['$resume'], component.env, true)
+  end
+end
+
+
+-- Layout-only update on display changes, e.g. rotation without rebuilding,
+-- controllers receive `config` through `$configure`
+function Component.configure(component, config)
+  local scope = component.scope
+  if scope['$panel'] then
+    Component.configure(scope['$panel'], config)
+  end
+
+  local controller = component.controller
+  if controller and controller['$configure'] then
+    callfenv(controller['$configure'], component.env, true, config)
+  end
+end
+
+
 function Component.destroy(component)
   local attr, scope = component.attr, component.scope
 
-  for id, key in pairs(scope['$dispatch']) do
-    Dispatcher.remove(platform.dispatcher, id, key)
-  end
+  unlink_slots(scope)
+  Dispatcher.remove_all(platform.dispatcher, scope['$dispatch'])
 
   for attr_name, watcher in pairs(scope['$watchers'].attr) do
-    assert(Observable.unwatch(attr, attr_name, watcher.func))
+    local removed = Observable.unwatch(attr, attr_name, watcher.func)
+    assert(removed)
+    releasefenv(watcher.func)
   end
 
   if scope['$panel'] then
     Component.destroy(scope['$panel'])
   end
+  dispose_computeds(scope)
 
   local controller = component.controller
   if controller and controller['$destroy'] then
-    bindfenv(controller['$destroy'], component.env, true)()
+    callfenv(controller['$destroy'], component.env, true)
   end
 
   if platform.destroy_element then
@@ -281,6 +585,7 @@ function Component.destroy(component)
   end
   component.element = nil
 
+  release_listeners(scope)
   setmetatable(scope, nil)
   for k in pairs(scope) do scope[k] = nil end
   scope['$destroyed'] = true
@@ -305,4 +610,29 @@ function Component:__tostring()
 end
 
 
+-- Drops pooled instances and the loaded definitions on full trims. Pooled
+-- definitions stay loaded, components in use release into their pool.
+function Component.trim(level)
+  if not platform.is_full_trim(level) then return end
+  for _, definition in pairs(Component.cache) do
+    local pool = definition.pool
+    if pool then
+      for args, free in pairs(pool.free) do
+        for _, component in ipairs(free) do
+          Component.destroy(component)
+        end
+        pool.free[args] = nil
+      end
+      pool.n = 0
+    end
+  end
+  local kept = {}
+  for path, definition in pairs(Component.cache) do
+    if definition.pool then kept[path] = definition end
+  end
+  Component.cache = kept
+end
+platform.on_trim(Component.trim)
+
+
 return Component
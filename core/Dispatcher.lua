@@ -1,6 +1,11 @@
 local Dispatcher = {}
 
 
+-- Slab of `max` slots kept in parallel arrays (`items`, `keys`, `gens`).
+-- Unused ids are handed out from `next` first, released ids are reused in
+-- FIFO order from a ring buffer, so assign/get/remove are O(1) without
+-- per-item tables. The key of an item is the generation of its slot, bumped
+-- on every release, so handles to earlier items of a slot stay invalid.
 function Dispatcher.new(max_items)
   max_items = tonumber(max_items)
   assert(max_items, 'Expected number for max items')
@@ -8,7 +13,13 @@ function Dispatcher.new(max_items)
     next = 0,
     n = 0,
     max = max_items,
-    cycle = 0,
+    items = {},
+    keys = {},
+    gens = {},
+    free = {},
+    free_first = 0,
+    free_last = 0,
+    stale = 0,
   }
   return setmetatable(dispatcher, Dispatcher)
 end
@@ -19,37 +30,83 @@ function Dispatcher.assign(d, obj)
   d.n = d.n + 1
 
   local id
-  repeat
+  if d.next < d.max then
     id = d.next
-    d.next = (id + 1) % d.max
-  until d[id] == nil
-  if id == 0 then d.cycle = d.cycle + 1 end
-  d[id] = {obj, d.cycle}
-
-  return id, d.cycle
+    d.next = id + 1
+  else
+    local pos = d.free_first
+    id = d.free[pos % d.max]
+    d.free_first = pos + 1
+  end
+
+  local key = d.gens[id] or 0
+  d.items[id] = obj
+  d.keys[id] = key
+  return id, key
 end
 
 
 function Dispatcher.check(d, id, key)
-  assert(d[id], 'No item at id ' .. id)
-  assert(d[id][2] == key, 'Invalid key for item at id ' .. id)
+  local k = d.keys[id]
+  if k == key then return end
+  d.stale = d.stale + 1
+  if k == nil then
+    error('No item at id ' .. id, 2)
+  end
+  error('Invalid key for item at id ' .. id, 2)
 end
 
 
-function Dispatcher.remove(d, id, key)
-  Dispatcher.check(d, id, key)
-  if d[id] == nil then return end
+local function release(d, id)
+  local obj = d.items[id]
+  d.items[id] = nil
+  d.gens[id] = d.keys[id] + 1
+  d.keys[id] = nil
   d.n = d.n - 1
 
-  local res = d[id]
-  d[id] = nil
-  return res[1]
+  local pos = d.free_last
+  d.free[pos % d.max] = id
+  d.free_last = pos + 1
+  return obj
+end
+
+
+function Dispatcher.remove(d, id, key)
+  if d.keys[id] ~= key then Dispatcher.check(d, id, key) end
+  return release(d, id)
+end
+
+
+-- Releases every `id -> key` handle in `handles` that is still live,
+-- stale handles are skipped
+function Dispatcher.remove_all(d, handles)
+  local keys = d.keys
+  local count = 0
+  for id, key in pairs(handles) do
+    if keys[id] == key then
+      release(d, id)
+      count = count + 1
+    else
+      d.stale = d.stale + 1
+    end
+  end
+  return count
 end
 
 
 function Dispatcher.get(d, id, key)
-  Dispatcher.check(d, id, key)
-  return table.unpack(d[id])
+  if d.keys[id] ~= key then Dispatcher.check(d, id, key) end
+  return d.items[id], key
+end
+
+
+function Dispatcher.stats(d)
+  return {
+    n = d.n,
+    max = d.max,
+    occupancy = d.max > 0 and d.n / d.max or 0,
+    stale = d.stale,
+  }
 end
 
 
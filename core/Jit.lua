@@ -0,0 +1,136 @@
+local platform = require('platform')
+
+-- LuaJIT trace diagnostics
+--
+-- `Jit.start` attaches to the trace events of the JIT compiler and counts
+-- started, completed and aborted traces, aborts by reason and by the source
+-- location they happened at. `Jit.save` writes the report, by default to
+-- `<storage_path>/jit.trace`. Without LuaJIT `Jit.start` returns false.
+local Jit = {}
+
+local REPORT_LINES = 30
+
+local jit, jutil, vmdef
+local stats
+
+
+local function location(func, pc)
+  local info = jutil.funcinfo(func, pc)
+  if info.loc then return info.loc end
+  if info.ffid then return 'builtin#' .. info.ffid end
+  return '?'
+end
+
+
+-- Same formatting as jit.dump, the error code indexes a message format
+local function reason(err, info)
+  if type(err) ~= 'number' then return tostring(err) end
+  local format = vmdef and vmdef.traceerr[err]
+  if not format then return 'error ' .. err end
+  if type(info) == 'function' then info = location(info, 0) end
+  return string.format(format, info)
+end
+
+
+local function increment(t, key)
+  t[key] = (t[key] or 0) + 1
+end
+
+
+local function on_trace(what, tr, func, pc, otr, oex)
+  if what == 'start' then
+    stats.started = stats.started + 1
+    stats.starts[tr] = location(func, pc)
+  elseif what == 'stop' then
+    stats.completed = stats.completed + 1
+    increment(stats.compiled, stats.starts[tr] or '?')
+  elseif what == 'abort' then
+    stats.aborted = stats.aborted + 1
+    local why = reason(otr, oex)
+    increment(stats.reasons, why)
+    increment(stats.aborts, location(func, pc) .. '  ' .. why)
+  elseif what == 'flush' then
+    stats.flushed = stats.flushed + 1
+  end
+end
+
+
+function Jit.start()
+  jit = rawget(_G, 'jit')
+  if not jit or not jit.attach then return false end
+  jutil = require('jit.util')
+  -- Shipped with LuaJIT as a Lua file, reasons fall back to error codes
+  local ok, mod = pcall(require, 'jit.vmdef')
+  vmdef = ok and mod or nil
+
+  if stats then jit.attach(on_trace) end
+  stats = {
+    started = 0, completed = 0, aborted = 0, flushed = 0,
+    starts = {}, compiled = {}, reasons = {}, aborts = {},
+  }
+  jit.attach(on_trace, 'trace')
+  return true
+end
+
+
+-- Counts since `Jit.start`
+function Jit.stats()
+  return stats
+end
+
+
+local function sorted(counts)
+  local keys = {}
+  for key in pairs(counts) do table.insert(keys, key) end
+  table.sort(keys, function(a, b)
+    if counts[a] ~= counts[b] then return counts[a] > counts[b] end
+    return a < b
+  end)
+  return keys
+end
+
+
+local function section(lines, title, counts)
+  table.insert(lines, title)
+  for i, key in ipairs(sorted(counts)) do
+    if i > REPORT_LINES then break end
+    table.insert(lines, string.format('%8d  %s', counts[key], key))
+  end
+end
+
+
+function Jit.report()
+  assert(stats, 'Trace diagnostics not started')
+  local lines = {string.format(
+    'started %d  completed %d  aborted %d  flushed %d',
+    stats.started, stats.completed, stats.aborted, stats.flushed)}
+  section(lines, 'aborts by reason', stats.reasons)
+  section(lines, 'aborts by location', stats.aborts)
+  section(lines, 'completed by start location', stats.compiled)
+  return table.concat(lines, '\n') .. '\n'
+end
+
+
+-- Writes the report to `path`, by default `jit.trace` in the storage path
+function Jit.save(path)
+  path = path or (platform.storage_path or '.') .. '/jit.trace'
+  local f = assert(io.open(path, 'w'))
+  f:write(Jit.report())
+  f:close()
+  return path
+end
+
+
+-- Detaches after saving the report, returns the counts
+function Jit.stop(path)
+  if not stats then return nil end
+  jit.attach(on_trace)
+  Jit.save(path)
+
+  local result = stats
+  stats = nil
+  return result
+end
+
+
+return Jit
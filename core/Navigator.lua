@@ -0,0 +1,125 @@
+local platform = require('platform')
+local Component = require('core.Component')
+local Cache = require('core.Cache')
+
+-- Screen history with an LRU cache of the screens below the top one
+--
+-- Screens left by `push` are suspended and kept built, so `back` shows them
+-- again without building. The cache is bounded by screen count and by the
+-- Lua heap (in KB) each screen took to build, evicted screens are destroyed
+-- and built again when navigated back to.
+local Navigator = {
+  MAX_SCREENS = 4,
+  MAX_COST_KB = 16384,
+}
+
+-- Entries `{name, args, component, cost, config}`, the shown screen last
+Navigator.history = {}
+
+Navigator.cache = Cache.new({
+  max = Navigator.MAX_SCREENS,
+  max_cost = Navigator.MAX_COST_KB,
+  evict = function(entry, component)
+    Component.destroy(component)
+  end,
+})
+
+
+local function build(entry)
+  local before = collectgarbage('count')
+  local args = entry.args
+  entry.component = Component.build(entry.name, nil,
+    table.unpack(args, 1, args.n))
+  -- Collections during the build only make the estimate smaller
+  entry.cost = math.max(collectgarbage('count') - before, 1)
+  return entry.component
+end
+
+
+function Navigator.current()
+  local entry = Navigator.history[#Navigator.history]
+  return entry and entry.component
+end
+
+
+function Navigator.push(name, ...)
+  local history = Navigator.history
+  local top = history[#history]
+  if top then
+    Component.suspend(top.component)
+    Cache.put(Navigator.cache, top, top.component, top.cost)
+    top.component = nil
+  end
+
+  local entry = {name = name, args = table.pack(...), config = platform.config}
+  table.insert(history, entry)
+  platform.show_component(build(entry))
+  return entry.component
+end
+
+
+-- Shows the previous screen, returns false when there is none
+function Navigator.back()
+  local history = Navigator.history
+  if #history < 2 then return false end
+
+  local top = table.remove(history)
+  local entry = history[#history]
+  local component = Cache.take(Navigator.cache, entry)
+  if component then
+    entry.component = component
+    Component.resume(component)
+    -- Cached screens missed display changes while hidden
+    if entry.config ~= platform.config then
+      Component.configure(component, platform.config)
+    end
+  else
+    component = build(entry)
+  end
+  entry.config = platform.config
+
+  platform.show_component(component)
+  Component.destroy(top.component)
+  return true
+end
+
+
+-- Evicts cached screens until at most `max_cost` KB are cached, all of them
+-- by default
+function Navigator.trim(max_cost)
+  Cache.trim(Navigator.cache, max_cost or 0)
+end
+
+
+-- Passes a display change to the shown screen, cached screens get it when
+-- navigated back to
+function Navigator.configure(config)
+  local entry = Navigator.history[#Navigator.history]
+  if not entry then return end
+  entry.config = config
+  Component.configure(entry.component, config)
+end
+
+
+-- Empties the cache on full trims and halves it on other pressure, leaving
+-- the app (UI_HIDDEN) keeps it for instant back
+platform.on_trim(function(level)
+  if platform.is_full_trim(level) then
+    Navigator.trim()
+  elseif level ~= platform.TRIM.UI_HIDDEN then
+    Navigator.trim(Navigator.cache.cost / 2)
+  end
+end)
+
+
+-- Destroys all screens and forgets the history
+function Navigator.reset()
+  Cache.clear(Navigator.cache)
+  for _, entry in ipairs(Navigator.history) do
+    if entry.component then Component.destroy(entry.component) end
+  end
+  Navigator.history = {}
+end
+
+
+return Navigator
@@ -1,5 +1,26 @@
 local Observable = {}
 
+-- Dependency set of the computed value being evaluated, if any
+local tracking
+
+-- Computed values to re-evaluate once the outermost `Observable.set` is done
+local pending = {}
+local computeds = setmetatable({}, {__mode = 'k'})
+local depth = 0
+local flushing = false
+
+-- Watchers forwarding changes between slots and tables, they don't count as
+-- subscribers
+local forwarders = setmetatable({}, {__mode = 'k'})
+
+-- Scopes with paused watchers, and the changes held back for each watcher
+local suspended = setmetatable({}, {__mode = 'k'})
+local NIL = {}
+
+-- Receives writes, notifications and watcher calls while tracing, see
+-- core/Trace.lua
+local tracer
+
 
 local function is_observable(o)
   return getmetatable(o) == Observable
@@ -20,6 +41,33 @@ end
 Observable.is_indexable = is_indexable
 
 
+-- Whether notifying `o` of a change at `idx` reaches a subscriber. Only
+-- follows the forwarding chain as far as the change is forwarded: slots pass
+-- own changes to their owner table, tables pass all changes to the slots
+-- holding them.
+local function interested(o, idx)
+  if rawget(o, '$subscribers') > 0 then return true end
+  if rawget(o, '$slot') then
+    local owner = rawget(o, '$owner')
+    return idx == nil and owner ~= nil and interested(owner, rawget(o, '$idx'))
+  end
+  local containers = rawget(o, '$containers')
+  if containers then
+    for slot in pairs(containers) do
+      if interested(slot, idx) then return true end
+    end
+  end
+  return false
+end
+Observable.interested = interested
+
+
+local function forward(o, f, scope)
+  forwarders[f] = true
+  return Observable.watch(o, nil, f, scope)
+end
+
+
 local function observe_value(slot, v)
   assert(is_observable(slot) and slot['$slot'])
 
@@ -28,15 +76,25 @@ local function observe_value(slot, v)
   if slot_v ~= v and rawget(slot, '$value_observer') then
     assert(is_observable(slot_v))
     Observable.unwatch(slot_v, nil, slot['$value_observer'])
+    rawget(slot_v, '$containers')[slot] = nil
     rawset(slot, '$value_observer', nil)
   end
 
   -- Register new value observer
   if is_observable(v) and is_indexable(v) then
     rawset(slot, '$value_observer', function(v, idx, id)
-      Observable.notify(slot, idx, v, id)
+      if interested(slot, idx) then
+        Observable.notify(slot, idx, v, id)
+      end
     end)
-    Observable.watch(v, nil, slot['$value_observer'], slot)
+    forward(v, slot['$value_observer'], slot)
+
+    local containers = rawget(v, '$containers')
+    if not containers then
+      containers = {}
+      rawset(v, '$containers', containers)
+    end
+    containers[slot] = true
   end
 end
 
@@ -45,10 +103,11 @@ local function make_slot(o, t, idx, v)
   if is_table(v) then v = Observable.new(v) end
   local slot = Observable.new(v, {slot = true})
   rawset(slot, '$idx', idx)
+  rawset(slot, '$owner', o)
   t[idx] = slot
 
-  Observable.watch(slot, nil, function(v, idx, id)
-    if idx == nil then
+  forward(slot, function(v, idx, id)
+    if idx == nil and interested(o, slot['$idx']) then
       Observable.notify(o, slot['$idx'], v, id)
     end
   end)
@@ -58,6 +117,31 @@ local function make_slot(o, t, idx, v)
 end
 
 
+-- Slot at `t[idx]`. Values kept raw by `Observable.new` get their slot on
+-- first use.
+local function slot_at(o, t, idx)
+  local v = rawget(t, idx)
+  if v == nil then return t[idx] end
+  if is_observable(v) and rawget(v, '$slot') then return v end
+  return make_slot(o, t, idx, v)
+end
+
+
+-- Unwrapped value at `t[idx]`, raw scalars are read without a slot
+local function value_at(o, t, idx)
+  local v = rawget(t, idx)
+  if v == nil then return Observable.unwrap(t[idx]) end
+  if type(v) ~= 'table' then return v end
+  if not (is_observable(v) and rawget(v, '$slot')) then
+    v = make_slot(o, t, idx, v)
+  end
+  return Observable.unwrap(v)
+end
+
+
+-- Table values are shaped in place, their entries are kept raw until a key
+-- is indexed, watched or set, or iteration reaches a table value. Nested
+-- tables become [Observable] only then.
 function Observable.new(value, options)
   local o
   options = options or {}
@@ -73,7 +157,7 @@ function Observable.new(value, options)
     o = value
     local t = {}
     for k, v in pairs(o) do
-      make_slot(o, t, k, v)
+      t[k] = v
       o[k] = nil
     end
     o['$value'] = t
@@ -85,6 +169,7 @@ function Observable.new(value, options)
   o['$observers'] = setmetatable({}, {__mode = 'v'})
   o['$observers_id'] = setmetatable({}, {__mode = 'k'})
   o['$slot'] = options.slot or false
+  o['$subscribers'] = 0
   o['$merge'] = options.merge == nil and true or options.merge
 
   return setmetatable(o, Observable)
@@ -99,8 +184,16 @@ function Observable.wrap(v)
 end
 
 
+local evaluate
+
 function Observable.unwrap(o, mt)
   if is_observable(o) then
+    -- Values read while a set is notifying are the old ones, as for slots
+    local computed = rawget(o, '$computed')
+    if computed and computed.dirty and depth == 0 then
+      evaluate(o, computed)
+    end
+
     local v = rawget(o, '$value')
     if is_observable(v) then
       mt = rawget(v, '$mt') or mt
@@ -129,6 +222,12 @@ function Observable.watch(o, idx, f, scope, create_thread)
   if idx then o = Observable.index(o, idx, true) end
   scope = scope or rawget(getfenv(f), 'scope') or true
 
+  -- Computed values need their dependencies to notify watchers
+  local computed = rawget(o, '$computed')
+  if computed and computed.dirty and depth == 0 then
+    evaluate(o, computed)
+  end
+
   -- TODO: possible to get function env from thread ?
   if create_thread then f = coroutine.create(f) end
 
@@ -139,6 +238,9 @@ function Observable.watch(o, idx, f, scope, create_thread)
 
   o['$observers'][f] = scope
   ids[scope][f] = id
+  if not forwarders[f] then
+    rawset(o, '$subscribers', o['$subscribers'] + 1)
+  end
 
   return id, f
 end
@@ -156,6 +258,9 @@ function Observable.unwatch(o, idx, f)
   if scope then
     o['$observers'][f] = nil
     o['$observers_id'][scope][f] = nil
+    if not forwarders[f] then
+      rawset(o, '$subscribers', o['$subscribers'] - 1)
+    end
     return f
   end
 
@@ -163,7 +268,37 @@ function Observable.unwatch(o, idx, f)
 end
 
 
-function Observable.notify(o, idx, v, id)
+-- Keeps the latest change per index for a suspended watcher, a change of
+-- the whole value supersedes earlier ones
+local function hold(missed, o, callback, v, idx)
+  local changes = missed[callback]
+  if not changes or idx == nil then
+    changes = {o = o, order = {}, values = {}}
+    missed[callback] = changes
+  end
+  local key = idx == nil and NIL or idx
+  if changes.values[key] == nil then table.insert(changes.order, key) end
+  changes.values[key] = {v}
+end
+
+
+-- Calls a watcher, dropping coroutines that finished
+local function invoke(o, callback, v, idx, id)
+  if type(callback) == 'thread' then
+    if coroutine.status(callback) == 'dead' then
+      o['$observers'][callback] = nil
+      rawset(o, '$subscribers', o['$subscribers'] - 1)
+    else
+      local ok, msg = coroutine.resume(callback, v, idx, id)
+      if not ok then error(msg) end
+    end
+  else
+    callback(v, idx, id)
+  end
+end
+
+
+local function notify(o, idx, v, id)
   assert(is_observable(o))
 
   local observers = o['$observers']
@@ -176,19 +311,55 @@ function Observable.notify(o, idx, v, id)
     if type(scope) == 'table' and scope['$destroyed'] then
       observers[callback] = nil
       ids[callback] = nil
-    else
-      if type(callback) == 'thread' then
-        if coroutine.status(callback) == 'dead' then
-          observers[callback] = nil
-        else
-          if id == nil or ids[callback] ~= id then
-            local ok, msg = coroutine.resume(callback, v, idx, id)
-            if not ok then error(msg) end
-          end
-        end
+      if not forwarders[callback] then
+        rawset(o, '$subscribers', o['$subscribers'] - 1)
+      end
+    elseif suspended[scope] then
+      if id == nil or ids[callback] ~= id then
+        hold(suspended[scope], o, callback, v, idx)
+      end
+    elseif id == nil or ids[callback] ~= id then
+      if tracer and not forwarders[callback] then
+        tracer.watcher(invoke, o, callback, v, idx, id)
       else
-        if id == nil or ids[callback] ~=id then
-          callback(v, idx, id)
+        invoke(o, callback, v, idx, id)
+      end
+    end
+  end
+end
+
+
+function Observable.notify(o, idx, v, id)
+  if tracer then return tracer.notify(notify, o, idx, v, id) end
+  return notify(o, idx, v, id)
+end
+
+
+-- Pauses watchers registered with `scope`. Their changes are held back, only
+-- the latest one per index, until `Observable.resume`.
+function Observable.suspend(scope)
+  suspended[scope] = suspended[scope] or {}
+end
+
+
+function Observable.resume(scope)
+  local missed = suspended[scope]
+  if not missed then return end
+  suspended[scope] = nil
+  if rawget(scope, '$destroyed') then return end
+
+  for callback, changes in pairs(missed) do
+    -- Skip watchers removed meanwhile
+    if rawget(changes.o, '$observers')[callback] == scope then
+      for _, key in ipairs(changes.order) do
+        local v, idx = changes.values[key][1], key
+        if idx == NIL then idx = nil end
+        if type(callback) == 'thread' then
+          if coroutine.status(callback) == 'dead' then break end
+          local ok, msg = coroutine.resume(callback, v, idx)
+          if not ok then error(msg) end
+        else
+          callback(v, idx)
         end
       end
     end
@@ -196,7 +367,61 @@ function Observable.notify(o, idx, v, id)
 end
 
 
-function Observable.set(o, v, id)
+function Observable.is_suspended(scope)
+  return suspended[scope] ~= nil
+end
+
+
+-- Shallow comparison of a new computed result with the current value
+local function same(old, v)
+  if old == v then return true end
+  if not (is_table(v) and is_observable(old) and is_indexable(old)) then
+    return false
+  end
+
+  local t = Observable.unwrap_indexable(old)
+  local n = 0
+  for k, x in pairs(v) do
+    if Observable.unwrap(t[k]) ~= x then return false end
+    n = n + 1
+  end
+  for _, slot in pairs(t) do
+    if Observable.unwrap(slot) ~= nil then n = n - 1 end
+  end
+  return n == 0
+end
+
+
+-- Evaluates `fn` of computed slot `c`, tracking the slots it reads
+local function run(c, computed)
+  local deps = {}
+  local outer = tracking
+  tracking = deps
+  local ok, v = pcall(computed.fn)
+  tracking = outer
+  if not ok then error(v, 0) end
+
+  for dep in pairs(computed.deps) do
+    Observable.unwatch(dep, nil, computed.invalidate)
+  end
+  for dep in pairs(deps) do
+    Observable.watch(dep, nil, computed.invalidate, true)
+  end
+  computed.deps = deps
+  computed.dirty = false
+  return v
+end
+
+
+function evaluate(c, computed)
+  local v = run(c, computed)
+  if not same(rawget(c, '$value'), v) then
+    rawset(c, '$value', is_table(v) and Observable.new(v) or v)
+  end
+end
+
+
+local function set(o, v, id)
   assert(is_observable(o))
 
   if getmetatable(v) == nil then
@@ -206,7 +431,7 @@ function Observable.set(o, v, id)
 
       -- Merge keys into current table
       if v['$merge'] and o['$merge'] and is_indexable(o) then
-        Observable.notify(o, nil, v, id)
+        if interested(o, nil) then Observable.notify(o, nil, v, id) end
         for k, slot in Observable.spairs(o) do
           Observable.set(slot, v[k], id)
         end
@@ -220,10 +445,17 @@ function Observable.set(o, v, id)
     end
   end
 
-  Observable.notify(o, nil, v, id)
-  if is_indexable(v) then
-    for k, v in pairs(v) do
-      Observable.notify(o, k, v, id)
+  if interested(o, nil) then
+    Observable.notify(o, nil, v, id)
+    if is_indexable(v) then
+      -- Entries are passed as they are stored, notifying doesn't give the
+      -- raw ones slots
+      for k, value in next, Observable.unwrap_indexable(v) do
+        if is_observable(value) and rawget(value, '$slot') then
+          value = Observable.unwrap(value)
+        end
+        if value ~= nil then Observable.notify(o, k, value, id) end
+      end
     end
   end
 
@@ -232,11 +464,123 @@ function Observable.set(o, v, id)
 end
 
 
+-- Keeps the stack of errors rethrown once the nesting state is reset, errors
+-- already carrying one are passed on as they are
+local function traceback(err)
+  if type(err) ~= 'string' or err:find('\nstack traceback:', 1, true) then
+    return err
+  end
+  return debug.traceback(err, 2)
+end
+
+
+local function refresh()
+  while next(pending) do
+    local c = next(pending)
+    pending[c] = nil
+    local computed = rawget(c, '$computed')
+    if computed.dirty then
+      local old = rawget(c, '$value')
+      local v = run(c, computed)
+      if not same(old, v) then set(c, v) end
+    end
+  end
+end
+
+
+local function flush()
+  flushing = true
+  local ok, err = xpcall(refresh, traceback)
+  flushing = false
+  if not ok then error(err, 0) end
+end
+
+
+local function commit(o, v, id)
+  -- Computed values read new values, only available once the outermost set
+  -- is done. Nested sets only count, the outermost one resets on errors.
+  if depth > 0 then
+    depth = depth + 1
+    set(o, v, id)
+    depth = depth - 1
+    return
+  end
+  if next(computeds) == nil then return set(o, v, id) end
+
+  depth = 1
+  local ok, err = xpcall(set, traceback, o, v, id)
+  depth = 0
+  if not ok then error(err, 0) end
+  if not flushing and next(pending) then flush() end
+end
+
+
+function Observable.set(o, v, id)
+  if tracer then return tracer.write(commit, o, v, id) end
+  return commit(o, v, id)
+end
+
+
+-- Installs `t` with `write`, `notify` and `watcher`, each called with the
+-- function it wraps and its arguments. Nil stops tracing.
+function Observable.set_tracer(t)
+  tracer = t
+end
+
+
+-- Creates a slot whose value is `fn()`. Slots read by `fn` through indexing
+-- or iteration are tracked, a change to any of them marks the value dirty.
+-- Dirty values are evaluated lazily on read, or right after the change when
+-- the slot has watchers, which are only notified if the result differs.
+-- With `o` and `idx` the slot at `o[idx]` is made computed, so existing
+-- bindings to it follow the value.
+function Observable.computed(fn, o, idx)
+  local c = o and Observable.index(o, idx, true) or
+    Observable.new(nil, {slot = true})
+
+  local computed = {fn = fn, deps = {}, dirty = true}
+  function computed.invalidate()
+    if computed.dirty then return end
+    computed.dirty = true
+    if next(rawget(c, '$observers')) then pending[c] = true end
+  end
+
+  rawset(c, '$computed', computed)
+  computeds[c] = true
+
+  -- Values created by a component are disposed with it, `fn` may not refer
+  -- to its env without globals outside LuaJIT, then the caller's is used
+  local scope = rawget(getfenv(fn), 'scope')
+  local caller = not scope and debug.getinfo(2, 'fS')
+  if caller and caller.what == 'Lua' then
+    scope = rawget(getfenv(caller.func), 'scope')
+  end
+  local owned = is_observable(scope) and rawget(scope, '$computeds')
+  if owned then table.insert(owned, c) end
+  return c
+end
+
+
+-- Stops computed slot `c` from following its dependencies, it keeps the last
+-- evaluated value as a plain slot
+function Observable.dispose(c)
+  assert(is_observable(c))
+  local computed = rawget(c, '$computed')
+  if not computed then return end
+  for dep in pairs(computed.deps) do
+    Observable.unwatch(dep, nil, computed.invalidate)
+  end
+  computed.deps = {}
+  pending[c] = nil
+  computeds[c] = nil
+  rawset(c, '$computed', nil)
+end
+
+
 function Observable.set_index(o, idx, v, id)
   assert(is_observable(o))
   local t = Observable.unwrap_indexable(o)
-  local slot = t[idx]
-  if not slot then slot = make_slot(o, t, idx, nil) end
+  local slot = slot_at(o, t, idx) or make_slot(o, t, idx, nil)
   Observable.set(slot, v, id)
 end
 
@@ -244,11 +588,11 @@ end
 function Observable.index(o, idx, create_nil)
   assert(is_observable(o))
   local t = Observable.unwrap_indexable(o)
-  if t[idx] == nil then
-    if not create_nil then return nil end
-    make_slot(o, t, idx, nil)
+  local slot = slot_at(o, t, idx)
+  if slot == nil and create_nil then
+    slot = make_slot(o, t, idx, nil)
   end
-  return t[idx]
+  return slot
 end
 
 
@@ -271,7 +615,7 @@ end
 function Observable.del_slot(o, idx)
   assert(is_observable(o))
   local t = Observable.unwrap_indexable(o)
-  local slot = t[idx]
+  local slot = slot_at(o, t, idx)
   t[idx] = nil
   return slot
 end
@@ -279,13 +623,14 @@ end
 
 function Observable.next(o, idx)
   assert(is_observable(o))
+  if tracking then tracking[o] = true end
   local t = Observable.unwrap_indexable(o)
   local k = idx
   while true do
     k = next(t, k)
     if k == nil then return nil end
 
-    local v = Observable.unwrap(t[k])
+    local v = value_at(o, t, k)
     if v ~= nil then return k, v end
   end
 end
@@ -293,11 +638,13 @@ end
 
 function Observable.inext(o, idx)
   assert(is_observable(o))
+  if tracking then tracking[o] = true end
   local t = Observable.unwrap_indexable(o)
   local n = #t
   idx = idx + 1
-  local v = Observable.unwrap(t[idx])
-  if idx <= n and v ~= nil then return idx, v end
+  if idx > n then return nil end
+  local v = value_at(o, t, idx)
+  if v ~= nil then return idx, v end
 end
 
 
@@ -305,7 +652,8 @@ function Observable.snext(o, idx)
   assert(is_observable(o))
   local t = Observable.unwrap_indexable(o)
   local k = next(t, idx)
-  return k, t[k]
+  if k == nil then return nil end
+  return k, slot_at(o, t, k)
 end
 
 
@@ -321,17 +669,32 @@ end
 
 
 function Observable:__index(idx)
-  local slot = Observable.index(self, idx)
-  if slot == nil then return nil end
-  return Observable.unwrap(slot)
+  if tracking then
+    -- Missing keys get a slot too, so their creation is noticed
+    local slot = Observable.index(self, idx, true)
+    tracking[slot] = true
+    return Observable.unwrap(slot)
+  end
+
+  return value_at(self, Observable.unwrap_indexable(self), idx)
 end
 
 
+-- Counts entries up to the first nil as `ipairs` would, without giving raw
+-- entries slots
 function Observable:__len()
-  --TODO: optimize this
+  if tracking then tracking[self] = true end
+  local t = Observable.unwrap_indexable(self)
   local n = 0
-  for i in ipairs(self) do n = i end
-  return n
+  while true do
+    local v = rawget(t, n + 1)
+    if v == nil then
+      v = t[n + 1]
+      if v == nil then return n end
+    end
+    if is_observable(v) and Observable.unwrap(v) == nil then return n end
+    n = n + 1
+  end
 end
 
 
@@ -0,0 +1,201 @@
+local Scheduler = {
+  -- Task priorities, input work always runs to completion in a frame,
+  -- other work only while the frame budget lasts
+  INPUT = 1,
+  BUILD = 2,
+  IDLE = 3,
+}
+
+-- Default per-frame budget (ms), leaves room for layout and draw at 60fps
+local BUDGET = 8
+
+
+-- `options.clock` returns the current time in ms, `options.request_frame` asks
+-- the host for a frame callback which should call `Scheduler.frame`. Without
+-- `request_frame` nothing is driven and callers are expected to run work
+-- synchronously.
+function Scheduler.new(options)
+  options = options or {}
+  local scheduler = {
+    clock = options.clock or function() return os.clock() * 1000 end,
+    budget = options.budget or BUDGET,
+    request_frame = options.request_frame,
+    requested = false,
+    queues = {},
+    n = 0,
+    frames = 0,
+  }
+  for priority = Scheduler.INPUT, Scheduler.IDLE do
+    scheduler.queues[priority] = {first = 1, last = 0}
+  end
+  return setmetatable(scheduler, Scheduler)
+end
+
+
+function Scheduler.fake_clock(now)
+  local clock = {now = now or 0}
+  function clock.advance(ms)
+    clock.now = clock.now + ms
+  end
+  return setmetatable(clock, {__call = function() return clock.now end})
+end
+
+
+function Scheduler.is_driven(s)
+  return s.request_frame ~= nil
+end
+
+
+local function request(s)
+  if s.requested or not s.request_frame then return end
+  s.requested = true
+  s.request_frame()
+end
+
+
+-- Asks the host for a frame even without queued work, e.g. to poll for
+-- completed async requests
+function Scheduler.request(s)
+  request(s)
+end
+
+
+-- Queues `f(...)` as a unit of work. `f` runs inside a coroutine and may
+-- split itself with `coroutine.yield()`, letting the frame stop once the
+-- budget is spent and resume it in a later frame.
+function Scheduler.post(s, f, priority, ...)
+  priority = priority or Scheduler.BUILD
+  local queue = assert(s.queues[priority], 'Invalid priority')
+  local task = {
+    co = coroutine.create(f),
+    args = table.pack(...),
+    priority = priority,
+  }
+  queue.last = queue.last + 1
+  queue[queue.last] = task
+  s.n = s.n + 1
+  request(s)
+  return task
+end
+
+
+-- Resumes `task` once, returns true when it is finished
+local function step(task)
+  if task.done then return true end
+  local ok, err
+  if task.args then
+    local args = task.args
+    task.args = nil
+    ok, err = coroutine.resume(task.co, table.unpack(args, 1, args.n))
+  else
+    ok, err = coroutine.resume(task.co)
+  end
+  if not ok then
+    task.done = true
+    error(debug.traceback(task.co, err), 0)
+  end
+  task.done = coroutine.status(task.co) == 'dead'
+  return task.done
+end
+
+
+local function pop(s, queue)
+  local task = queue[queue.first]
+  queue[queue.first] = nil
+  queue.first = queue.first + 1
+  s.n = s.n - 1
+  return task
+end
+
+
+-- Runs `task` up to its next yield, e.g. to do the first slice of work
+-- synchronously
+function Scheduler.step(s, task)
+  return step(task)
+end
+
+
+function Scheduler.cancel(s, task)
+  task.done = true
+end
+
+
+-- Runs the rest of `task` synchronously
+function Scheduler.finish(s, task)
+  while not task.done do
+    step(task)
+  end
+end
+
+
+-- Wraps `f` so that calls are queued instead of run in place, e.g. for
+-- watchers doing heavy work. Calls run directly when frames aren't driven.
+function Scheduler.wrap(s, f, priority)
+  return function(...)
+    if not s.request_frame then return f(...) end
+    Scheduler.post(s, f, priority or Scheduler.IDLE, ...)
+  end
+end
+
+
+function Scheduler.pending(s, priority)
+  if not priority then return s.n end
+  local queue = s.queues[priority]
+  return queue.last - queue.first + 1
+end
+
+
+-- Runs queued work for one frame and returns the number of pending tasks
+function Scheduler.frame(s)
+  s.requested = false
+  s.frames = s.frames + 1
+  local start = s.clock()
+
+  local priority = Scheduler.INPUT
+  while priority <= Scheduler.IDLE do
+    local queue = s.queues[priority]
+    if queue.first > queue.last then
+      priority = priority + 1
+    elseif priority > Scheduler.INPUT and s.clock() - start >= s.budget then
+      break
+    else
+      local task = queue[queue.first]
+      local ok, done = pcall(step, task)
+      if not ok then
+        -- The rest of the queue runs in the next frame
+        pop(s, queue)
+        if s.n > 0 then request(s) end
+        error(done, 0)
+      end
+      if done then pop(s, queue) end
+
+      -- Input posted meanwhile preempts the remaining background work
+      if Scheduler.pending(s, Scheduler.INPUT) > 0 then
+        priority = Scheduler.INPUT
+      end
+    end
+  end
+
+  if s.n > 0 then request(s) end
+  return s.n
+end
+
+
+-- Runs frames until no work is left, for headless use
+function Scheduler.drain(s, clock, frame_ms)
+  local frames = 0
+  while s.n > 0 do
+    Scheduler.frame(s)
+    if clock then clock.advance(frame_ms or 16) end
+    frames = frames + 1
+  end
+  return frames
+end
+
+
+function Scheduler:__tostring()
+  return string.format('Scheduler(n: %d, budget: %d)', self.n, self.budget)
+end
+
+
+return Scheduler
@@ -0,0 +1,294 @@
+local platform = require('platform')
+local Observable = require('core.Observable')
+
+-- Compact binary snapshots of Observable trees
+--
+-- Only values and nesting are stored, watchers are not. Layout:
+--
+--   snapshot := 'SLK' version:byte value
+--   value    := FALSE | TRUE | INT varint | NUMBER varint:len bytes
+--             | STRING varint:len bytes | INF | NEG_INF | NAN
+--             | TABLE varint:size varint:narr varint:nhash
+--               value{narr} (value value){nhash}
+--
+-- Tables are prefixed with their size in bytes, so a loader can skip
+-- subtrees and restore only the part it needs. Integers are zigzag encoded
+-- varints. Infinities and NaN get their own tags, their '%.17g' text doesn't
+-- read back. Functions, userdata and tables with a metatable other than
+-- Observable are left out.
+
+local Snapshot = {}
+
+local VERSION = 1
+local HEADER = 'SLK' .. string.char(VERSION)
+
+local FALSE, TRUE, INT, NUMBER, STRING, TABLE = 0, 1, 2, 3, 4, 5
+local INF, NEG_INF, NAN = 6, 7, 8
+
+local byte, char, sub = string.byte, string.char, string.sub
+local floor = math.floor
+
+local ok, new_table = pcall(require, 'table.new')
+if not ok then new_table = function() return {} end end
+
+
+local function varint(n)
+  if n < 128 then return char(n) end
+  local t = {}
+  while n >= 128 do
+    t[#t + 1] = char(n % 128 + 128)
+    n = floor(n / 128)
+  end
+  t[#t + 1] = char(n)
+  return table.concat(t)
+end
+
+
+local function read_varint(data, pos)
+  local n, mul = 0, 1
+  while true do
+    local b = byte(data, pos)
+    pos = pos + 1
+    if b < 128 then return n + b * mul, pos end
+    n = n + (b - 128) * mul
+    mul = mul * 128
+  end
+end
+
+
+local function is_int(v)
+  return v == floor(v) and v >= -2^53 and v <= 2^53
+end
+
+
+local encode
+
+-- Tables being encoded, shared ones are fine but cycles can't be written
+local visiting = {}
+
+local function encode_table(t, buf)
+  -- `t` is the raw slot table of an Observable or a plain table
+  local raw = Observable.is_observable(t)
+  if raw then t = Observable.unwrap_indexable(t) end
+  if visiting[t] then error('Cyclic snapshot value', 0) end
+  visiting[t] = true
+  local function get(k)
+    local v = t[k]
+    if raw then v = Observable.unwrap(v) end
+    return v
+  end
+
+  local body = {}
+  local narr = 0
+  while get(narr + 1) ~= nil do
+    narr = narr + 1
+    if not encode(get(narr), body) then
+      -- Unsupported value, keep the index as hash entry
+      narr = narr - 1
+      break
+    end
+  end
+
+  local nhash = 0
+  for k, v in pairs(t) do
+    if raw then v = Observable.unwrap(v) end
+    local tk = type(k)
+    if v ~= nil and not (tk == 'number' and k >= 1 and k <= narr and
+        is_int(k)) and (tk == 'string' or tk == 'number') then
+      local n = #body
+      encode(k, body)
+      if encode(v, body) then
+        nhash = nhash + 1
+      else
+        for i = #body, n + 1, -1 do body[i] = nil end
+      end
+    end
+  end
+
+  body = table.concat(body)
+  local head = varint(narr) .. varint(nhash)
+  buf[#buf + 1] = char(TABLE)
+  buf[#buf + 1] = varint(#head + #body)
+  buf[#buf + 1] = head
+  buf[#buf + 1] = body
+  visiting[t] = nil
+end
+
+
+-- Appends the encoding of `v` to `buf`, returns false for unsupported values
+function encode(v, buf)
+  local tv = type(v)
+  if tv == 'boolean' then
+    buf[#buf + 1] = char(v and TRUE or FALSE)
+  elseif tv == 'number' then
+    if is_int(v) then
+      buf[#buf + 1] = char(INT)
+      buf[#buf + 1] = varint(v >= 0 and v * 2 or -v * 2 - 1)
+    elseif v ~= v then
+      buf[#buf + 1] = char(NAN)
+    elseif v == math.huge or v == -math.huge then
+      buf[#buf + 1] = char(v > 0 and INF or NEG_INF)
+    else
+      local s = string.format('%.17g', v)
+      buf[#buf + 1] = char(NUMBER)
+      buf[#buf + 1] = varint(#s)
+      buf[#buf + 1] = s
+    end
+  elseif tv == 'string' then
+    buf[#buf + 1] = char(STRING)
+    buf[#buf + 1] = varint(#v)
+    buf[#buf + 1] = v
+  elseif tv == 'table' and (getmetatable(v) == nil or
+      (Observable.is_observable(v) and Observable.is_indexable(v))) then
+    encode_table(v, buf)
+  else
+    return false
+  end
+  return true
+end
+
+
+local decode
+
+local function decode_table(data, pos)
+  local size
+  size, pos = read_varint(data, pos)
+  local narr, nhash
+  narr, pos = read_varint(data, pos)
+  nhash, pos = read_varint(data, pos)
+
+  local t = new_table(narr, nhash)
+  for i = 1, narr do
+    t[i], pos = decode(data, pos)
+  end
+  for _ = 1, nhash do
+    local k
+    k, pos = decode(data, pos)
+    t[k], pos = decode(data, pos)
+  end
+  return t, pos
+end
+
+
+function decode(data, pos)
+  local tag = byte(data, pos)
+  pos = pos + 1
+  if tag == TABLE then
+    return decode_table(data, pos)
+  elseif tag == INT then
+    local z
+    z, pos = read_varint(data, pos)
+    return z % 2 == 0 and floor(z / 2) or -floor((z + 1) / 2), pos
+  elseif tag == STRING or tag == NUMBER then
+    local n
+    n, pos = read_varint(data, pos)
+    local s = sub(data, pos, pos + n - 1)
+    if tag == NUMBER then s = tonumber(s) end
+    return s, pos + n
+  elseif tag == TRUE or tag == FALSE then
+    return tag == TRUE, pos
+  elseif tag == INF or tag == NEG_INF then
+    return tag == INF and math.huge or -math.huge, pos
+  elseif tag == NAN then
+    return 0 / 0, pos
+  end
+  error('Invalid snapshot value at ' .. (pos - 1))
+end
+
+
+-- Returns the position after the value at `pos`, without decoding it
+local function skip(data, pos)
+  local tag = byte(data, pos)
+  pos = pos + 1
+  if tag == TABLE or tag == STRING or tag == NUMBER then
+    local n
+    n, pos = read_varint(data, pos)
+    return pos + n
+  elseif tag == INT then
+    local _
+    _, pos = read_varint(data, pos)
+    return pos
+  end
+  return pos
+end
+
+
+-- Finds `key` in the table at `pos`, decoding only keys
+local function find(data, pos, key)
+  if byte(data, pos) ~= TABLE then return end
+  local _, narr, nhash
+  _, pos = read_varint(data, pos + 1)
+  narr, pos = read_varint(data, pos)
+  nhash, pos = read_varint(data, pos)
+
+  for i = 1, narr do
+    if i == key then return pos end
+    pos = skip(data, pos)
+  end
+  for _ = 1, nhash do
+    local k
+    k, pos = decode(data, pos)
+    if k == key then return pos end
+    pos = skip(data, pos)
+  end
+end
+
+
+function Snapshot.dump(o)
+  -- Left over by a dump that failed on a cycle
+  visiting = {}
+  local buf = {HEADER}
+  if not encode(o, buf) then
+    error('Unsupported snapshot value', 2)
+  end
+  return table.concat(buf)
+end
+
+
+-- Decodes the value at `path` (list of keys) in `data`, or the whole
+-- snapshot, into plain tables
+function Snapshot.load(data, path)
+  assert(sub(data, 1, #HEADER) == HEADER, 'Invalid snapshot')
+  local pos = #HEADER + 1
+  for _, key in ipairs(path or {}) do
+    pos = find(data, pos, key)
+    if not pos then return nil end
+  end
+  return (decode(data, pos))
+end
+
+
+local function file_path(name)
+  assert(platform.storage_path, 'No storage path')
+  return platform.storage_path .. '/' .. name
+end
+
+
+function Snapshot.save(o, name)
+  local f = assert(io.open(file_path(name), 'wb'))
+  f:write(Snapshot.dump(o))
+  f:close()
+end
+
+
+function Snapshot.read(name)
+  local f = io.open(file_path(name), 'rb')
+  if not f then return nil end
+  local data = f:read('*a')
+  f:close()
+  return data
+end
+
+
+-- Restores the saved tree `name`, or only its subtree at `path`, as an
+-- Observable
+function Snapshot.restore(name, path)
+  local data = Snapshot.read(name)
+  if not data then return nil end
+  local v = Snapshot.load(data, path)
+  if type(v) == 'table' then v = Observable.new(v) end
+  return v
+end
+
+
+return Snapshot
@@ -0,0 +1,168 @@
+local platform = require('platform')
+local IndexRecorder = require('core.IndexRecorder')
+local Observable = require('core.Observable')
+
+-- Style sheets of component definitions
+--
+--     style {
+--       Text = {text_size = 18, text_color = '#333333', padding = attr.gap},
+--     }
+--
+-- A sheet styles the elements of the definition's view by type, on top of
+-- the sheet the element's own definition has for its type. Both are compiled
+-- once per pair of definitions into a platform plan applied with one call.
+-- Values bound to `attr.x` of the declaring component are left out of the
+-- plan and set on their own, again whenever that attr changes.
+local Style = {
+  properties = {
+    width = true,
+    height = true,
+    padding = true,
+    background_color = true,
+    text_color = true,
+    text_size = true,
+    alpha = true,
+    orientation = true,
+  },
+  keywords = {match = -1, wrap = -2, horizontal = 0, vertical = 1},
+}
+
+local ROOT = {}
+
+-- Plans by declaring definition and styled definition
+local plans = setmetatable({}, {__mode = 'k'})
+
+
+-- Numeric value of a style value, colors are given as '#rrggbb' or
+-- '#aarrggbb' and become ARGB numbers
+function Style.value(v)
+  if type(v) == 'string' then
+    local hex = v:match('^#(%x+)$')
+    if hex and #hex == 6 then return 0xff000000 + tonumber(hex, 16) end
+    if hex and #hex == 8 then return tonumber(hex, 16) end
+    v = Style.keywords[v]
+  end
+  if type(v) ~= 'number' then
+    error('Invalid style value: ' .. tostring(v), 2)
+  end
+  return v
+end
+
+
+local function merge(entries, sheet, own)
+  for name, v in pairs(sheet or {}) do
+    if not Style.properties[name] then
+      error('Unknown style property: ' .. tostring(name))
+    end
+    if getmetatable(v) == IndexRecorder then
+      local info = IndexRecorder.info(v)
+      if info.type ~= 'attr' or #v ~= 1 then
+        error('Invalid style binding: ' .. IndexRecorder.value(v))
+      end
+      entries[name] = {attr = v[1], own = own}
+    else
+      entries[name] = {value = Style.value(v)}
+    end
+  end
+end
+
+
+local function compile(definition, owner)
+  local kind = definition.name:match('[^.]+$')
+  local entries = {}
+  merge(entries, definition.style[kind], true)
+  if owner then merge(entries, owner.style[kind], false) end
+
+  local static, n = {}, 0
+  local plan = {dynamic = {}, names = {}}
+  for name, entry in pairs(entries) do
+    plan.names[name] = true
+    if entry.attr then
+      table.insert(plan.dynamic, {name = name, attr = entry.attr,
+        own = entry.own})
+    else
+      static[name] = entry.value
+      n = n + 1
+    end
+  end
+  if n > 0 then plan.static = platform.compile_style(static) end
+  return plan
+end
+
+
+function Style.plan(definition, owner)
+  local by_owner = plans[owner or ROOT]
+  if not by_owner then
+    by_owner = {}
+    plans[owner or ROOT] = by_owner
+  end
+  local plan = by_owner[definition]
+  if not plan then
+    plan = compile(definition, owner)
+    by_owner[definition] = plan
+  end
+  return plan
+end
+
+
+-- Properties set by `previous` and not by `plan`
+local function left_over(previous, plan)
+  local names = {}
+  for name in pairs(previous.names) do
+    if not plan.names[name] then table.insert(names, name) end
+  end
+  return names
+end
+
+
+-- Styles the element of a built `component`, its parent is the component
+-- whose view declared it. Pooled components styled by another parent before
+-- have the properties only that parent set cleared.
+function Style.apply(component)
+  if not platform.apply_style then return end
+  local scope = component.scope
+  local parent = rawget(scope, '$parent')
+  local plan = Style.plan(component.definition,
+    parent and parent.definition)
+
+  local element = component.element
+  local previous = rawget(scope, '$style_plan')
+  if previous ~= plan then
+    if previous then
+      local names = left_over(previous, plan)
+      if #names > 0 then platform.clear_style(element, names) end
+    end
+    if plan.static then platform.apply_style(element, plan.static) end
+    rawset(scope, '$style_plan', plan)
+  end
+  if #plan.dynamic == 0 then return end
+
+  local watchers = {}
+  for _, binding in ipairs(plan.dynamic) do
+    local attr = binding.own and component.attr or parent.attr
+    local name = binding.name
+    local f = function(v, idx)
+      if idx == nil and v ~= nil then
+        platform.set_style(element, name, Style.value(v))
+      end
+    end
+    local slot = Observable.index(attr, binding.attr, true)
+    Observable.watch(slot, nil, f, scope)
+    table.insert(watchers, {slot, f})
+    f(Observable.unwrap(slot))
+  end
+  rawset(scope, '$style', watchers)
+end
+
+
+-- Stops updating attr bound properties, before a component is pooled
+function Style.detach(component)
+  local scope = component.scope
+  for _, watcher in ipairs(rawget(scope, '$style') or {}) do
+    Observable.unwatch(watcher[1], nil, watcher[2])
+  end
+  rawset(scope, '$style', nil)
+end
+
+
+return Style
@@ -0,0 +1,94 @@
+-- Text changed through edits, for edit fields reporting deltas
+--
+-- Offsets count UTF-16 code units, as Android reports them, the text itself
+-- is UTF-8. Edits are only applied once the value is needed. An edit ending
+-- where the last one did, like typing, deleting or an IME rewriting the word
+-- being composed, extends that edit in place.
+local TextBuffer = {}
+
+
+-- UTF-16 code units of UTF-8 `s`, 4 byte sequences take two
+local function units(s)
+  local continuation = select(2, s:gsub('[\128-\191]', ''))
+  local wide = select(2, s:gsub('[\240-\247]', ''))
+  return #s - continuation + wide
+end
+TextBuffer.units = units
+
+
+-- Byte length of the first `n` code units of `s`, scanning on from byte
+-- `from` (0-based) already at unit `at`
+local function prefix(s, n, from, at)
+  local i, u = (from or 0) + 1, at or 0
+  while u < n do
+    -- ASCII runs take one unit per byte, skipped with one search
+    local wide = s:find('[\128-\255]', i)
+    if not wide or wide - i >= n - u then
+      return math.min(i - 1 + n - u, #s)
+    end
+    u = u + wide - i
+    local b = s:byte(wide)
+    if b >= 0xF0 then
+      i, u = wide + 4, u + 2
+    elseif b >= 0xE0 then
+      i, u = wide + 3, u + 1
+    else
+      i, u = wide + 2, u + 1
+    end
+  end
+  return i - 1
+end
+
+
+function TextBuffer.new(text)
+  return {text = text or '', edits = {}}
+end
+
+
+-- Replaces `before` units at `start` (0-based) with `inserted`
+function TextBuffer.edit(b, start, before, inserted)
+  local last = b.edits[#b.edits]
+  if last then
+    local last_end = last.start + last.n
+    if start >= last.start and start + before == last_end then
+      local keep = start - last.start
+      if keep < last.n then
+        last.inserted = last.inserted:sub(1, prefix(last.inserted, keep))
+      end
+      last.inserted = last.inserted .. inserted
+      last.n = keep + units(inserted)
+      return
+    end
+  end
+  table.insert(b.edits, {
+    start = start,
+    before = before,
+    inserted = inserted,
+    n = units(inserted),
+  })
+end
+
+
+function TextBuffer.pending(b)
+  return #b.edits > 0
+end
+
+
+function TextBuffer.value(b)
+  local text = b.text
+  for _, e in ipairs(b.edits) do
+    local from = prefix(text, e.start)
+    local to = prefix(text, e.start + e.before, from, e.start)
+    text = text:sub(1, from) .. e.inserted .. text:sub(to + 1)
+  end
+  b.text, b.edits = text, {}
+  return text
+end
+
+
+function TextBuffer.set(b, text)
+  b.text, b.edits = text or '', {}
+end
+
+
+return TextBuffer
@@ -0,0 +1,321 @@
+local platform = require('platform')
+local Observable = require('core.Observable')
+
+-- Observable notification tracing
+--
+-- `Trace.start` hooks into Observable writes. Each outermost `set` or
+-- `set_index` becomes a write record with its origin (the first caller
+-- outside Observable), its notifications counted by level (1 for the written
+-- slot, one more per forwarding or cascading step) and the watchers it
+-- called with their time, writes made by those watchers included. Slots are
+-- counted as notified, with their watchers. `Trace.report` ranks slots and
+-- writes, `Trace.save` exports the writes in the Chrome trace event format,
+-- for chrome://tracing or Perfetto.
+local Trace = {}
+
+local REPORT_LINES = 30
+local MAX_WRITES = 10000
+
+local trace
+local clock
+
+-- Sources of Observable and of this module, skipped looking for origins
+local source, own_source
+
+-- Write being recorded and the notification level within it
+local current
+local level = 0
+
+local labels = setmetatable({}, {__mode = 'k'})
+local locations = setmetatable({}, {__mode = 'k'})
+
+
+-- Dotted path of the indexes leading to `o`, as far as owners are known
+local function label(o)
+  local name = labels[o]
+  if name then return name end
+
+  local parts = {}
+  local at = o
+  while at and #parts < 8 do
+    local idx = rawget(at, '$idx')
+    if idx ~= nil then
+      table.insert(parts, 1, tostring(idx))
+      at = rawget(at, '$owner')
+    else
+      local containers = rawget(at, '$containers')
+      at = containers and next(containers)
+    end
+  end
+  name = #parts > 0 and table.concat(parts, '.') or '<root>'
+  labels[o] = name
+  return name
+end
+
+
+local function location(f)
+  local name = locations[f]
+  if name then return name end
+  if type(f) == 'thread' then
+    name = 'thread'
+  else
+    local info = debug.getinfo(f, 'S')
+    name = info.short_src .. ':' .. info.linedefined
+  end
+  locations[f] = name
+  return name
+end
+
+
+-- First caller outside Observable and the tracer
+local function origin()
+  for i = 3, 40 do
+    local info = debug.getinfo(i, 'Sl')
+    if not info then break end
+    if info.what ~= 'C' and info.short_src ~= source and
+        info.short_src ~= own_source then
+      return info.short_src .. ':' .. info.currentline
+    end
+  end
+  return '?'
+end
+
+
+local function slot_stats(o)
+  local s = trace.slots[o]
+  if not s then
+    s = {label = label(o), subscribers = 0, notifies = 0, calls = 0, time = 0}
+    trace.slots[o] = s
+  end
+  return s
+end
+
+
+-- Message handler of the recorder frames, the stack is taken where the error
+-- was raised since the frames rethrow it after restoring the nesting
+local function traceback(err)
+  if type(err) ~= 'string' or err:find('\nstack traceback:', 1, true) then
+    return err
+  end
+  return debug.traceback(err, 2)
+end
+
+
+local function finish(outer, outer_level, ok, ...)
+  current, level = outer, outer_level
+  if not ok then error((...), 0) end
+  return ...
+end
+
+
+local function write(commit, o, v, id)
+  local outer, outer_level = current, level
+  local start = clock()
+  local record = {
+    origin = origin(),
+    label = label(o),
+    level = level,
+    start = start,
+  }
+
+  if outer then
+    table.insert(outer.events, record)
+    outer.writes = outer.writes + 1
+    record.root = outer.root
+  elseif #trace.writes < trace.max_writes then
+    record.events, record.notifies, record.writes = {}, {}, 0
+    record.root = record
+    table.insert(trace.writes, record)
+  else
+    trace.dropped = trace.dropped + 1
+    return commit(o, v, id)
+  end
+  current = record.root
+
+  local function done(...)
+    record.time = clock() - start
+    return ...
+  end
+  return done(finish(outer, outer_level, xpcall(commit, traceback, o, v, id)))
+end
+
+
+local function notify(f, o, idx, v, id)
+  local s = slot_stats(o)
+  s.notifies = s.notifies + 1
+  s.subscribers = math.max(s.subscribers, rawget(o, '$subscribers'))
+
+  local outer_level = level
+  level = level + 1
+  if current then
+    local notifies = current.notifies
+    notifies[level] = (notifies[level] or 0) + 1
+  end
+  return finish(current, outer_level, xpcall(f, traceback, o, idx, v, id))
+end
+
+
+local function watcher(invoke, o, callback, v, idx, id)
+  local start = clock()
+  local ok, err = xpcall(invoke, traceback, o, callback, v, idx, id)
+  local time = clock() - start
+
+  local s = slot_stats(o)
+  s.calls = s.calls + 1
+  s.time = s.time + time
+  if current then
+    table.insert(current.events, {
+      watcher = location(callback),
+      label = s.label,
+      level = level,
+      start = start,
+      time = time,
+    })
+  end
+  if not ok then error(err, 0) end
+end
+
+
+-- Starts recording, `options.clock` returns milliseconds and defaults to
+-- `os.clock`, `options.max_writes` bounds the outermost writes kept
+function Trace.start(options)
+  options = options or {}
+  clock = options.clock or function() return os.clock() * 1000 end
+  source = debug.getinfo(Observable.set, 'S').short_src
+  own_source = debug.getinfo(1, 'S').short_src
+  trace = {
+    writes = {},
+    slots = setmetatable({}, {__mode = 'k'}),
+    dropped = 0,
+    max_writes = options.max_writes or MAX_WRITES,
+  }
+  current, level = nil, 0
+  Observable.set_tracer({write = write, notify = notify, watcher = watcher})
+end
+
+
+-- Writes and slot counts since `Trace.start`
+function Trace.stats()
+  return trace
+end
+
+
+local function top(list, key)
+  table.sort(list, function(a, b) return key(a) > key(b) end)
+  local result = {}
+  for i = 1, math.min(#list, REPORT_LINES) do result[i] = list[i] end
+  return result
+end
+
+
+local function fan_out(w)
+  local n = 0
+  for _, count in pairs(w.notifies) do n = n + count end
+  return n
+end
+
+
+local function levels(w)
+  local counts = {}
+  for i = 1, #w.notifies do counts[i] = w.notifies[i] or 0 end
+  return table.concat(counts, '/')
+end
+
+
+function Trace.report()
+  assert(trace, 'Tracing not started')
+  local slots = {}
+  for _, s in pairs(trace.slots) do table.insert(slots, s) end
+
+  local lines = {string.format('writes %d  dropped %d  slots %d',
+    #trace.writes, trace.dropped, #slots)}
+
+  table.insert(lines, 'slots by watchers')
+  for _, s in ipairs(top(slots, function(s) return s.subscribers end)) do
+    table.insert(lines, string.format('%8d  %s  (%d notifies, %d calls)',
+      s.subscribers, s.label, s.notifies, s.calls))
+  end
+
+  table.insert(lines, 'slots by watcher time (ms)')
+  for _, s in ipairs(top(slots, function(s) return s.time end)) do
+    table.insert(lines, string.format('%8.2f  %s  (%d calls)',
+      s.time, s.label, s.calls))
+  end
+
+  table.insert(lines, 'writes by notifies (per level)')
+  local writes = {}
+  for _, w in ipairs(trace.writes) do table.insert(writes, w) end
+  for _, w in ipairs(top(writes, fan_out)) do
+    table.insert(lines, string.format('%8d  %s  %s  [%s]  %d writes  %.2f ms',
+      fan_out(w), w.label, w.origin, levels(w), w.writes, w.time or 0))
+  end
+  return table.concat(lines, '\n') .. '\n'
+end
+
+
+local function quote(s)
+  return '"' .. tostring(s):gsub('[%c"\\]', function(c)
+    return string.format('\\u%04x', c:byte())
+  end) .. '"'
+end
+
+
+local function event(out, name, category, start, time, args)
+  local fields = {}
+  for key, value in pairs(args) do
+    table.insert(fields, quote(key) .. ':' ..
+      (type(value) == 'number' and string.format('%d', value) or quote(value)))
+  end
+  table.insert(out, string.format(
+    '{"name":%s,"cat":"%s","ph":"X","ts":%.0f,"dur":%.0f,' ..
+    '"pid":1,"tid":1,"args":{%s}}',
+    quote(name), category, start * 1000, (time or 0) * 1000,
+    table.concat(fields, ',')))
+end
+
+
+-- Chrome trace event JSON of the recorded writes, times in microseconds
+function Trace.export()
+  assert(trace, 'Tracing not started')
+  local out = {}
+  for _, w in ipairs(trace.writes) do
+    event(out, w.label, 'write', w.start, w.time, {
+      origin = w.origin,
+      notifies = levels(w),
+      writes = w.writes,
+    })
+    for _, e in ipairs(w.events) do
+      if e.watcher then
+        event(out, e.watcher, 'watcher', e.start, e.time,
+          {slot = e.label, level = e.level})
+      else
+        event(out, e.label, 'write', e.start, e.time,
+          {origin = e.origin, level = e.level})
+      end
+    end
+  end
+  return '{"traceEvents":[\n' .. table.concat(out, ',\n') .. '\n]}\n'
+end
+
+
+-- Writes the export to `path`, by default `observable.trace.json` in the
+-- storage path
+function Trace.save(path)
+  path = path or (platform.storage_path or '.') .. '/observable.trace.json'
+  local f = assert(io.open(path, 'w'))
+  f:write(Trace.export())
+  f:close()
+  return path
+end
+
+
+-- Stops recording, returns the writes and slot counts
+function Trace.stop()
+  Observable.set_tracer(nil)
+  local result = trace
+  trace, current, level = nil, nil, 0
+  return result
+end
+
+
+return Trace
@@ -0,0 +1,4 @@
+-- Build settings, release packages get a generated copy of this module
+return {
+  release = false,
+}
@@ -1,4 +1,7 @@
+local native_setfenv = rawget(_G, 'setfenv')
 local cache = setmetatable({}, {__mode = 'k'})
+local dumps = setmetatable({}, {__mode = 'k'})
+local async_funcs = setmetatable({}, {__mode = 'k'})
 
 
 local function find_env(f)
@@ -44,10 +47,99 @@ getfenv = rawget(_G, 'getfenv') or function(f)
 end
 
 
-function bindfenv(f, env, global_env)
+-- Loaded clones of a function no longer in use, rebound by `clonefenv`
+-- instead of loading the dump again
+local SPARE_MAX = 64
+local spares = setmetatable({}, {__mode = 'k'})
+local origins = setmetatable({}, {__mode = 'k'})
+local env_ups = setmetatable({}, {__mode = 'k'})
+local released = {}
+local function released_env() return released end
+
+
+local function load_clone(f)
+  local dump = dumps[f]
+  if not dump then
+    dump = string.dump(f)
+    dumps[f] = dump
+  end
+
+  local clone = load(dump, nil, 'b')
+  local up = 1
+  while true do
+    local name = debug.getupvalue(f, up)
+    if name == nil then break end
+    if name == '_ENV' then
+      env_ups[f] = up
+    else
+      debug.upvaluejoin(clone, up, f, up)
+    end
+    up = up + 1
+  end
+  return clone
+end
+
+
+-- Copy of `f` running directly in `env`, other upvalues are shared with `f`.
+-- Clones released with `releasefenv` are reused, only their env is rebound.
+function clonefenv(f, env)
+  assert(type(f) == 'function', '[function] expected')
+  if debug.getinfo(f, 'S').what == 'C' then return f end
+
+  local spare = spares[f]
+  local clone = spare and table.remove(spare) or load_clone(f)
+  origins[clone] = f
+
+  local up = env_ups[f]
+  if up then debug.upvaluejoin(clone, up, function() return env end, 1) end
+  if native_setfenv then native_setfenv(clone, env) end
+  return clone
+end
+
+
+-- Hands `clone` back for reuse, it must not be called afterwards
+function releasefenv(clone)
+  local f = origins[clone]
+  if not f then return end
+  origins[clone] = nil
+
+  local spare = spares[f]
+  if not spare then
+    spare = {}
+    spares[f] = spare
+  end
+  if #spare >= SPARE_MAX then return end
+
+  local up = env_ups[f]
+  if up then debug.upvaluejoin(clone, up, released_env, 1) end
+  if native_setfenv then native_setfenv(clone, released) end
+  table.insert(spare, clone)
+end
+
+
+-- Mark `f` to run in its own coroutine when bound, so it can yield
+function async(f)
+  assert(type(f) == 'function', '[function] expected')
+  async_funcs[f] = true
+  return f
+end
+
+
+local function with_globals(env, global_env)
   if global_env == true then global_env = _G end
+  local mt = getmetatable(env)
+  if mt and mt.__index == global_env then return env end
+  return setmetatable(env, {__index = global_env})
+end
+
+
+function bindfenv(f, env, global_env)
+  local new_env = with_globals(env, global_env)
+  if not async_funcs[f] then
+    return clonefenv(f, new_env)
+  end
+
   return function(...)
-    local new_env = setmetatable(env, {__index = global_env})
     local t = coroutine.create(f)
     local args = table.pack(...)
 
@@ -67,8 +159,24 @@ function bindfenv(f, env, global_env)
         end
       end
 
-      if coroutine.status(t) == 'dead' then return res end
+      if coroutine.status(t) == 'dead' then
+        return table.unpack(res, 2, res.n)
+      end
       args = table.pack(coroutine.yield(table.unpack(res, 2, res.n)))
     end
   end
 end
+
+
+local function settle(clone, ...)
+  releasefenv(clone)
+  return ...
+end
+
+
+-- Calls `f(...)` once in `env`, without keeping a clone per call
+function callfenv(f, env, global_env, ...)
+  if async_funcs[f] then return bindfenv(f, env, global_env)(...) end
+  local clone = clonefenv(f, with_globals(env, global_env))
+  return settle(clone, clone(...))
+end
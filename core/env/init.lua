@@ -1,4 +1,8 @@
-require('core.env.strict')
+local build = require('core.env.build')
+
+if not build.release then
+  require('core.env.strict')
+end
 require('core.env.fenv')
 require('core.env.table')
 
@@ -1,14 +1,38 @@
 local platform = require('platform').is('android')
 local Component = require('core.Component')
 local Dispatcher = require('core.Dispatcher')
+local Motion = require('platform.common.Motion')
 
 local java = require('platform.android.java')
 local Activity = java.import('android.app.Activity')
+local MutableContextWrapper = java.import('android.content.MutableContextWrapper')
 local ScrollView = java.import('android.widget.ScrollView')
 local EventListener = java.import('com.slick.core.EventListener')
+local FrameScheduler = java.import('com.slick.core.FrameScheduler')
+local MotionListener = java.import('com.slick.core.MotionListener')
+local StylePlan = java.import('com.slick.core.Style$Plan')
+
+-- Property codes of com.slick.core.Style
+local STYLE_PROPERTIES = {
+  width = 1,
+  height = 2,
+  padding = 3,
+  background_color = 4,
+  text_color = 5,
+  text_size = 6,
+  alpha = 7,
+  orientation = 8,
+}
+
+-- android.content.res.Configuration.ORIENTATION_LANDSCAPE
+local ORIENTATION_LANDSCAPE = 2
 
 platform.activity_stack = {}
 
+platform.on_trim(function(level)
+  if platform.is_full_trim(level) then java.trim() end
+end)
+
 
 function platform.loadfile(name)
   local file = _internal.inflate('assets/' .. name)
@@ -19,6 +43,48 @@ function platform.loadfile(name)
 end
 
 
+-- Opens `name` from the packaged assets for reading in chunks with constant
+-- memory, the handle has read, chunks, seek, size, stored and close
+function platform.open_asset(name)
+  local asset = _internal.open_asset('assets/' .. name)
+  if not asset then return nil, 'No such asset: ' .. name end
+  return asset
+end
+
+
+-- Reads `name` from the packaged assets on an I/O thread, returns its
+-- contents or nil and an error. Reads in place when not awaitable.
+function platform.read_asset_async(name)
+  if not platform.can_await() then
+    local data = _internal.inflate('assets/' .. name)
+    if not data then return nil, 'No such asset: ' .. name end
+    return data
+  end
+  return platform.await(_internal.read_async('asset', 'assets/' .. name))
+end
+
+
+function platform.read_file_async(path)
+  if not platform.can_await() then
+    local f, err = io.open(path, 'rb')
+    if not f then return nil, err end
+    local data = f:read('*a')
+    f:close()
+    return data
+  end
+  return platform.await(_internal.read_async('file', path))
+end
+
+
+function platform.poll()
+  while true do
+    local id, data, err = _internal.poll_io()
+    if not id then break end
+    platform.complete(id, data, err)
+  end
+end
+
+
 function platform.print(...)
   local args = table.pack(...)
   args = table.imap(args, function(v) return tostring(v) end)
@@ -26,16 +92,77 @@ function platform.print(...)
 end
 
 
+-- Style plans are held by Java, applying one is a single JNI call
+function platform.compile_style(props)
+  local codes, values = {}, {}
+  for name, value in pairs(props) do
+    table.insert(codes, STYLE_PROPERTIES[name])
+    table.insert(values, value)
+  end
+  return StylePlan(codes, values)
+end
+
+
+function platform.apply_style(element, plan)
+  _internal.apply_style(element._ref, plan._ref)
+end
+
+
+function platform.set_style(element, name, value)
+  _internal.set_style(element._ref, STYLE_PROPERTIES[name], value)
+end
+
+
+-- NaN values reset properties to the view's defaults, see Style.java
+function platform.clear_style(element, names)
+  local codes, values = {}, {}
+  for i, name in ipairs(names) do
+    codes[i], values[i] = STYLE_PROPERTIES[name], 0 / 0
+  end
+  _internal.apply_style(element._ref, StylePlan(codes, values)._ref)
+end
+
+
 function platform.push_component(component)
   table.insert(platform.activity_stack, platform.activity)
   local component = Component.build(component)
+  platform.show_component(component)
+  return component
+end
 
-  local wrapper = ScrollView(platform.activity)
-  wrapper:setVerticalScrollBarEnabled(false)
-  wrapper:setHorizontalScrollBarEnabled(false)
-  wrapper:addView(component.element)
 
-  platform.activity:setContentView(wrapper)
+-- Makes a built component the content view, components shown before keep
+-- their wrapper to be shown again
+function platform.show_component(component)
+  local scope = component.scope
+  local view = rawget(scope, '$content_view')
+  if view then
+    platform.activity:setContentView(view)
+    return
+  end
+
+  -- Components containing their own scrolling views (virtual panels) must
+  -- not be nested in a ScrollView, as it measures them at full height
+  if rawget(scope, '$scrolls') then
+    view = component.element
+  else
+    view = ScrollView(platform.context)
+    view:setVerticalScrollBarEnabled(false)
+    view:setHorizontalScrollBarEnabled(false)
+    view:addView(component.element)
+  end
+
+  rawset(scope, '$content_view', view)
+  platform.activity:setContentView(view)
+end
+
+
+function platform.set_scrolls(scope)
+  local component = scope['$component']
+  while rawget(component.scope, '$parent') do
+    component = rawget(component.scope, '$parent')
+  end
+  rawset(component.scope, '$scrolls', true)
 end
 
 
@@ -45,22 +172,43 @@ function platform.build(component)
     platform.event_listener(component.scope, 'setOnClickListener', function()
       component.env.trigger('click')
     end)
+
+    Motion.bind(component)
   end
 end
 
 
-function platform.event_listener(scope, event, listener)
+function platform.dispatch(scope, listener)
   local id, key = Dispatcher.assign(platform.dispatcher, listener)
-  local element = scope['$element']
   scope['$dispatch'][id] = key
-  element[event](element, EventListener(id, key))
+  return id, key
+end
+
+
+function platform.event_listener(scope, event, listener)
+  local element = scope['$element']
+  element[event](element, EventListener(platform.dispatch(scope, listener)))
+end
+
+
+-- Moves reach `listener(action, x, y, vx, vy)` once per frame, coalesced by
+-- MotionListener before crossing into Lua
+function platform.touch_listener(scope, listener)
+  local element = scope['$element']
+  element:setOnTouchListener(MotionListener(platform.dispatch(scope, listener)))
+end
+
+
+function platform.scroll_listener(scope, listener)
+  local motion = MotionListener(platform.dispatch(scope, listener))
+  motion:watchScroll(scope['$element'])
 end
 
 
 function platform.on_event(id, key, ...)
   local listener = Dispatcher.get(platform.dispatcher, id, key)
   if listener then
-    listener(...)
+    return platform.run(listener, ...)
   end
 end
 
@@ -71,6 +219,39 @@ function platform.bootstrap(activity)
 
   assert(activity)
   platform.activity = java.reference(activity, Activity)
+  -- Views are created with a context that can move to a recreated activity
+  platform.context = MutableContextWrapper(platform.activity)
+  platform.storage_path = _internal.storage_path
+
+  -- Scheduled work runs in Choreographer frame callbacks
+  local frames = FrameScheduler()
+  platform.scheduler.clock = _internal.clock
+  platform.scheduler.request_frame = function()
+    frames:request()
+  end
+end
+
+
+-- Shows the kept component tree in `activity`, recreated after a
+-- configuration change. The old activity removed the views from its window.
+function platform.attach(activity)
+  assert(activity)
+  platform.activity = java.reference(activity, Activity)
+  platform.context:setBaseContext(platform.activity)
+
+  local component = require('core.Navigator').current()
+  if component then platform.show_component(component) end
+end
+
+
+-- Display changes of the activity, `orientation` as in Configuration
+function platform.on_configuration(orientation, width, height)
+  platform.configure({
+    orientation = orientation == ORIENTATION_LANDSCAPE and 'landscape'
+      or 'portrait',
+    width = width,
+    height = height,
+  })
 end
 
 
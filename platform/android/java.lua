@@ -65,4 +65,11 @@ function java.method(cls, name)
 end
 
 
+-- Forgets imported classes, modules keep the ones they hold. Their methods
+-- and the Java references of both are released once collected.
+function java.trim()
+  import_cache = {}
+end
+
+
 return java
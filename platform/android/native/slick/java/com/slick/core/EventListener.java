@@ -2,13 +2,11 @@ package com.slick.core;
 
 import android.view.View;
 import android.view.View.OnClickListener;
-import android.view.View.OnTouchListener;
-import android.view.MotionEvent;
 import android.text.TextWatcher;
 import android.text.Editable;
 
 public class EventListener
-  implements OnClickListener, OnTouchListener, TextWatcher
+  implements OnClickListener, TextWatcher
 {
   private long id;
   private long key;
@@ -22,10 +20,6 @@ public class EventListener
     Lua.call("platform", "on_event", this.id, this.key);
   }
 
-  public boolean onTouch(View v, MotionEvent e) {
-    return true;
-  }
-
   public void onTextChanged(CharSequence s, int start, int before, int count) {
     Lua.call("platform", "on_event", this.id, this.key, s.toString());
   }
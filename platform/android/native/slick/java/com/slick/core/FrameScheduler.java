@@ -0,0 +1,19 @@
+package com.slick.core;
+
+import android.view.Choreographer;
+
+public class FrameScheduler implements Choreographer.FrameCallback {
+  private boolean posted = false;
+
+  public void request() {
+    // At most one callback per frame, Lua asks again while work is left
+    if (posted) return;
+    posted = true;
+    Choreographer.getInstance().postFrameCallback(this);
+  }
+
+  public void doFrame(long frameTimeNanos) {
+    posted = false;
+    Lua.call("platform", "on_frame");
+  }
+}
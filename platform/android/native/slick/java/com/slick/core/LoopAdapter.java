@@ -0,0 +1,79 @@
+package com.slick.core;
+
+import android.os.Handler;
+import android.os.Looper;
+import android.view.View;
+import android.view.ViewGroup;
+import android.widget.AbsListView;
+import android.widget.BaseAdapter;
+
+public class LoopAdapter extends BaseAdapter {
+  private long id;
+  private long key;
+  private int count = 0;
+  private int rows = 0;
+  private boolean pending = false;
+  private Handler handler = new Handler(Looper.getMainLooper());
+
+  public LoopAdapter(long id, long key) {
+    this.id = id;
+    this.key = key;
+  }
+
+  public void invalidate() {
+    // Coalesce loop changes into one count refresh per looper turn
+    if (pending) return;
+    pending = true;
+    handler.post(new Runnable() {
+      public void run() {
+        pending = false;
+        Object n = Lua.call("platform", "on_event", id, key, 0, -1);
+        count = n != null ? ((Number)n).intValue() : 0;
+        notifyDataSetChanged();
+      }
+    });
+  }
+
+  public int getCount() {
+    return count;
+  }
+
+  public Object getItem(int position) {
+    return null;
+  }
+
+  public long getItemId(int position) {
+    return position;
+  }
+
+  public View getView(int position, View convertView, ViewGroup parent) {
+    // Each view is tagged with the id of the row component bound to it,
+    // placeholders of failed rows are not and get a new row when reused
+    Object tag = convertView != null ? convertView.getTag() : null;
+    Integer row = tag instanceof Integer ? (Integer)tag : rows++;
+    Object result = Lua.call(
+      "platform", "on_event", this.id, this.key, position + 1, row);
+    if (!(result instanceof View)) {
+      // The row builder failed, Lua.call has logged the error
+      return placeholder(parent);
+    }
+    View view = (View)result;
+    view.setTag(row);
+
+    ViewGroup.LayoutParams params = view.getLayoutParams();
+    if (!(params instanceof AbsListView.LayoutParams)) {
+      view.setLayoutParams(new AbsListView.LayoutParams(
+        AbsListView.LayoutParams.MATCH_PARENT,
+        AbsListView.LayoutParams.WRAP_CONTENT));
+    }
+    return view;
+  }
+
+  private static View placeholder(ViewGroup parent) {
+    View view = new View(parent.getContext());
+    view.setLayoutParams(new AbsListView.LayoutParams(
+      AbsListView.LayoutParams.MATCH_PARENT,
+      AbsListView.LayoutParams.WRAP_CONTENT));
+    return view;
+  }
+}
@@ -1,19 +1,103 @@
 package com.slick.core;
 
 import android.app.Activity;
+import android.os.SystemClock;
 
 public class Lua {
+  private static final long created = SystemClock.uptimeMillis();
+  private static final StringBuilder timeline = new StringBuilder();
+  private static Thread startup;
+  private static Throwable startupError;
+  private static boolean running = false;
+
   public static void init(Activity activity) {
     final String storagePath = activity.getApplicationInfo().dataDir;
     final String apkPath = activity.getPackageResourcePath();
     Lua.init(apkPath, storagePath);
   }
 
+  // Creates the state and preloads `entry` on a startup thread, calls have
+  // to wait for it with `await`. With `jitTrace` LuaJIT trace events are
+  // counted from the start, see core/Jit.lua.
+  public static void start(
+      Activity activity, final String entry, final boolean jitTrace) {
+    final String storagePath = activity.getApplicationInfo().dataDir;
+    final String apkPath = activity.getPackageResourcePath();
+    running = true;
+    startup = new Thread(new Runnable() {
+      public void run() {
+        try {
+          mark("start");
+          Lua.init(apkPath, storagePath);
+          if (jitTrace) Lua.call("core.Jit", "start");
+          mark("state");
+          Lua.call("platform", "set", "android");
+          mark("platform");
+          Lua.call("platform", "preload", entry);
+          mark("preload");
+        } catch(Throwable e) {
+          startupError = e;
+        }
+      }
+    }, "slick-startup");
+    startup.start();
+  }
+
+  // Blocks until the startup thread is done
+  public static void await() {
+    if (startup == null) return;
+    mark("await");
+    boolean interrupted = false;
+    while (startup.isAlive()) {
+      try {
+        startup.join();
+      } catch(InterruptedException e) {
+        interrupted = true;
+      }
+    }
+    startup = null;
+    mark("ready");
+    if (interrupted) Thread.currentThread().interrupt();
+    if (startupError != null) {
+      throw new RuntimeException("Lua startup failed", startupError);
+    }
+  }
+
+  // Whether a state was started and not closed, it outlives activities
+  // recreated on configuration changes
+  public static boolean isRunning() {
+    return running;
+  }
+
+  public static void close() {
+    if (!running) return;
+    running = false;
+    try {
+      await();
+    } catch(RuntimeException e) {
+      // Already reported by the activity
+    }
+    startupError = null;
+    destroy();
+  }
+
+  // Records `event` on the startup timeline with the time since class load
+  // and the thread it happened on
+  public static synchronized void mark(String event) {
+    timeline.append(String.format("%6d ms  %-14s %s\n",
+      SystemClock.uptimeMillis() - created,
+      Thread.currentThread().getName(), event));
+  }
+
+  public static synchronized String timeline() {
+    return timeline.toString();
+  }
+
   static {
     System.loadLibrary("slick");
   }
 
   private static native long init(String apkPath, String storagePath);
-  public static native void call(String module, String func, Object... args);
-  public static native void destroy();
+  public static native Object call(String module, String func, Object... args);
+  private static native void destroy();
 }
@@ -0,0 +1,135 @@
+package com.slick.core;
+
+import android.view.Choreographer;
+import android.view.MotionEvent;
+import android.view.VelocityTracker;
+import android.view.View;
+import android.view.View.OnAttachStateChangeListener;
+import android.view.View.OnTouchListener;
+import android.view.ViewTreeObserver.OnScrollChangedListener;
+
+// Touch and scroll events for Lua, moves and scrolls are coalesced so that
+// only the latest position (px) and velocity (px/s) cross into Lua once per
+// frame. Down, up and cancel are delivered right away.
+public class MotionListener
+  implements OnTouchListener, OnScrollChangedListener,
+    OnAttachStateChangeListener, Choreographer.FrameCallback
+{
+  // Scrolls further apart than this start from rest
+  private static final long SCROLL_IDLE_NANOS = 100000000L;
+
+  private long id;
+  private long key;
+  private View scrolled;
+  private VelocityTracker tracker;
+  private boolean posted = false;
+  private boolean moved = false;
+  private boolean scroll = false;
+  private float x, y;
+  private int scrollX, scrollY;
+  private long scrollTime;
+
+  public MotionListener(long id, long key) {
+    this.id = id;
+    this.key = key;
+  }
+
+  // Listens to scroll changes of `view`, delivered as "scroll". The tree
+  // observer is shared by the window, so the listener is only registered
+  // while the view is attached.
+  public void watchScroll(View view) {
+    scrolled = view;
+    view.addOnAttachStateChangeListener(this);
+    if (view.getWindowToken() != null) onViewAttachedToWindow(view);
+  }
+
+  public void onViewAttachedToWindow(View v) {
+    v.getViewTreeObserver().addOnScrollChangedListener(this);
+  }
+
+  public void onViewDetachedFromWindow(View v) {
+    v.getViewTreeObserver().removeOnScrollChangedListener(this);
+  }
+
+  public boolean onTouch(View v, MotionEvent e) {
+    x = e.getX();
+    y = e.getY();
+    switch (e.getActionMasked()) {
+      case MotionEvent.ACTION_DOWN:
+        if (tracker == null) tracker = VelocityTracker.obtain();
+        tracker.clear();
+        tracker.addMovement(e);
+        moved = false;
+        deliver("down", 0, 0);
+        break;
+      case MotionEvent.ACTION_MOVE:
+        if (tracker != null) tracker.addMovement(e);
+        moved = true;
+        request();
+        break;
+      case MotionEvent.ACTION_UP:
+      case MotionEvent.ACTION_CANCEL:
+        // A pending move is superseded by the final position
+        moved = false;
+        float vx = 0, vy = 0;
+        if (tracker != null) {
+          tracker.addMovement(e);
+          tracker.computeCurrentVelocity(1000);
+          vx = tracker.getXVelocity();
+          vy = tracker.getYVelocity();
+          tracker.recycle();
+          tracker = null;
+        }
+        String action =
+          e.getActionMasked() == MotionEvent.ACTION_UP ? "up" : "cancel";
+        deliver(action, vx, vy);
+        break;
+    }
+    // The view keeps its own click and scroll handling
+    v.onTouchEvent(e);
+    return true;
+  }
+
+  public void onScrollChanged() {
+    scroll = true;
+    request();
+  }
+
+  public void doFrame(long frameTimeNanos) {
+    posted = false;
+    if (moved && tracker != null) {
+      moved = false;
+      tracker.computeCurrentVelocity(1000);
+      deliver("move", tracker.getXVelocity(), tracker.getYVelocity());
+    }
+    if (scroll && scrolled != null) {
+      // The tree observer reports scrolls anywhere in the window
+      scroll = false;
+      int sx = scrolled.getScrollX(), sy = scrolled.getScrollY();
+      if (sx == scrollX && sy == scrollY) return;
+      // Velocity over the frames between the last two delivered scrolls
+      float vx = 0, vy = 0;
+      long elapsed = frameTimeNanos - scrollTime;
+      if (scrollTime != 0 && elapsed > 0 && elapsed <= SCROLL_IDLE_NANOS) {
+        vx = (sx - scrollX) * 1e9f / elapsed;
+        vy = (sy - scrollY) * 1e9f / elapsed;
+      }
+      scrollX = sx;
+      scrollY = sy;
+      scrollTime = frameTimeNanos;
+      Lua.call("platform", "on_event", this.id, this.key, "scroll",
+        sx, sy, vx, vy);
+    }
+  }
+
+  private void request() {
+    // At most one callback per frame for all pending moves and scrolls
+    if (posted) return;
+    posted = true;
+    Choreographer.getInstance().postFrameCallback(this);
+  }
+
+  private void deliver(String action, float vx, float vy) {
+    Lua.call("platform", "on_event", this.id, this.key, action, x, y, vx, vy);
+  }
+}
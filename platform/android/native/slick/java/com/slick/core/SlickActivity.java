@@ -1,8 +1,12 @@
 package com.slick.core;
 
 import android.app.Activity;
+import android.content.ComponentCallbacks2;
+import android.content.res.Configuration;
 import android.os.Bundle;
+import android.os.SystemClock;
 import android.util.Log;
+import android.view.ViewGroup;
 import android.content.pm.PackageManager;
 import android.content.pm.PackageManager.NameNotFoundException;
 import android.content.pm.ApplicationInfo;
@@ -10,29 +14,120 @@ import android.content.pm.ApplicationInfo;
 public class SlickActivity extends Activity {
   public static final String TAG = "slick";
   public long luaState;
+  private boolean jitTrace;
+  private boolean ready = false;
 
   @Override
   public void onCreate(Bundle savedInstanceState) {
-    super.onCreate(savedInstanceState);
+    Lua.mark("create");
+    long start = SystemClock.uptimeMillis();
     String entry;
     try {
       ApplicationInfo info = getPackageManager().getApplicationInfo(
         getPackageName(), PackageManager.GET_META_DATA);
       entry = info.metaData.getString("entry");
+      jitTrace = info.metaData.getBoolean("jit_trace");
     } catch(NameNotFoundException e) {
+      super.onCreate(savedInstanceState);
       Log.e(TAG, "Cannot find entry in metadata");
       return;
     }
 
+    // After a configuration change the state and the built component tree
+    // are kept, only their views move to this activity
+    if (Lua.isRunning()) {
+      super.onCreate(savedInstanceState);
+      Lua.call("platform", "attach", this);
+      configure(getResources().getConfiguration());
+      ready = true;
+      Log.i(TAG, "Attached in " + (SystemClock.uptimeMillis() - start) + " ms");
+      return;
+    }
+
+    // The state is created and modules are loaded while the activity starts
     Log.i(TAG, "Loading...");
+    Lua.start(this, entry, jitTrace);
+    super.onCreate(savedInstanceState);
+    Lua.mark("activity");
+
     try {
-      Lua.init(this);
+      Lua.await();
       Log.i(TAG, "Init successful");
-      Lua.call("platform", "set", "android");
+      configure(getResources().getConfiguration());
       Lua.call("platform", "init", entry, this);
+      Lua.mark("first view");
+      ready = true;
     } catch(Throwable e) {
       Log.e(TAG, "Failed to init entry");
       Log.e(TAG, "Java exception", e);
     }
+    Log.i(TAG, "Startup timeline:\n" + Lua.timeline());
+  }
+
+  @Override
+  public void onDestroy() {
+    super.onDestroy();
+    boolean attached = ready;
+    ready = false;
+    if (attached && isChangingConfigurations()) {
+      // Views go to the next activity, see platform.attach
+      ViewGroup content = (ViewGroup) findViewById(android.R.id.content);
+      content.removeAllViews();
+    } else {
+      // Finished, or the state failed to start and the next activity retries
+      Lua.close();
+    }
+  }
+
+  // Only called for the changes declared in android:configChanges, the
+  // activity is kept and components update their layout through $configure
+  @Override
+  public void onConfigurationChanged(Configuration config) {
+    super.onConfigurationChanged(config);
+    if (ready) configure(config);
+  }
+
+  private void configure(Configuration config) {
+    Lua.call("platform", "on_configuration", config.orientation,
+      config.screenWidthDp, config.screenHeightDp);
+  }
+
+  @Override
+  public void onPause() {
+    super.onPause();
+    // Trace diagnostics are written to jit.trace in the app storage
+    if (jitTrace) Lua.call("core.Jit", "save");
+  }
+
+  @Override
+  public void onTrimMemory(int level) {
+    super.onTrimMemory(level);
+    trimMemory(level);
+  }
+
+  @Override
+  public void onLowMemory() {
+    super.onLowMemory();
+    trimMemory(ComponentCallbacks2.TRIM_MEMORY_COMPLETE);
+  }
+
+  // Lua releases caches by level, see platform.trim_memory, Java references
+  // held by collected objects go with them
+  private void trimMemory(int level) {
+    if (!ready) return;
+    Runtime runtime = Runtime.getRuntime();
+    long before = runtime.totalMemory() - runtime.freeMemory();
+    Lua.call("platform", "trim_memory", level);
+    long after = runtime.totalMemory() - runtime.freeMemory();
+    Log.i(TAG, String.format("Trim memory (level %d): Java heap %d KB -> %d KB",
+      level, before / 1024, after / 1024));
+  }
+
+  @Override
+  public void onBackPressed() {
+    // Navigator shows the previous screen, the activity finishes on the first
+    if (!Boolean.TRUE.equals(Lua.call("core.Navigator", "back"))) {
+      super.onBackPressed();
+    }
   }
 }
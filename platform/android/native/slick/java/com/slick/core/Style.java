@@ -0,0 +1,130 @@
+package com.slick.core;
+
+import android.content.res.ColorStateList;
+import android.content.res.TypedArray;
+import android.util.TypedValue;
+import android.view.View;
+import android.view.ViewGroup;
+import android.widget.LinearLayout;
+import android.widget.TextView;
+
+// Applies compiled style plans, the property codes match STYLE_PROPERTIES in
+// platform/android/init.lua. NaN values reset a property to its default.
+public class Style {
+  public static final int WIDTH = 1;
+  public static final int HEIGHT = 2;
+  public static final int PADDING = 3;
+  public static final int BACKGROUND_COLOR = 4;
+  public static final int TEXT_COLOR = 5;
+  public static final int TEXT_SIZE = 6;
+  public static final int ALPHA = 7;
+  public static final int ORIENTATION = 8;
+
+  public static class Plan {
+    final int[] props;
+    final double[] values;
+
+    public Plan(int[] props, double[] values) {
+      this.props = props;
+      this.values = values;
+    }
+  }
+
+  public static void apply(View view, Plan plan) {
+    // Width and height share one LayoutParams update
+    ViewGroup.LayoutParams params = null;
+    for (int i = 0; i < plan.props.length; i++) {
+      int prop = plan.props[i];
+      double value = plan.values[i];
+      if (Double.isNaN(value)) {
+        value = reset(view, prop);
+        if (Double.isNaN(value)) continue;
+      }
+      if (prop == WIDTH || prop == HEIGHT) {
+        if (params == null) params = layoutParams(view);
+        if (prop == WIDTH) params.width = (int)value;
+        else params.height = (int)value;
+      } else {
+        set(view, prop, value);
+      }
+    }
+    if (params != null) view.setLayoutParams(params);
+  }
+
+  public static void set(View view, int prop, double value) {
+    switch (prop) {
+      case WIDTH:
+      case HEIGHT:
+        ViewGroup.LayoutParams params = layoutParams(view);
+        if (prop == WIDTH) params.width = (int)value;
+        else params.height = (int)value;
+        view.setLayoutParams(params);
+        break;
+      case PADDING:
+        int padding = (int)value;
+        view.setPadding(padding, padding, padding, padding);
+        break;
+      case BACKGROUND_COLOR:
+        view.setBackgroundColor((int)(long)value);
+        break;
+      case TEXT_COLOR:
+        if (view instanceof TextView) {
+          ((TextView)view).setTextColor((int)(long)value);
+        }
+        break;
+      case TEXT_SIZE:
+        if (view instanceof TextView) {
+          ((TextView)view).setTextSize(
+            TypedValue.COMPLEX_UNIT_SP, (float)value);
+        }
+        break;
+      case ALPHA:
+        view.setAlpha((float)value);
+        break;
+      case ORIENTATION:
+        if (view instanceof LinearLayout) {
+          ((LinearLayout)view).setOrientation((int)value);
+        }
+        break;
+    }
+  }
+
+  // Resets properties without a plain default value, returns the default
+  // value of the others
+  private static double reset(View view, int prop) {
+    switch (prop) {
+      case WIDTH:
+      case HEIGHT:
+        return ViewGroup.LayoutParams.WRAP_CONTENT;
+      case BACKGROUND_COLOR:
+        view.setBackground(null);
+        return Double.NaN;
+      case TEXT_COLOR:
+        if (view instanceof TextView) {
+          TypedArray a = view.getContext().obtainStyledAttributes(
+            new int[] {android.R.attr.textColorPrimary});
+          ColorStateList colors = a.getColorStateList(0);
+          a.recycle();
+          if (colors != null) ((TextView)view).setTextColor(colors);
+        }
+        return Double.NaN;
+      case TEXT_SIZE:
+        return 14;
+      case ALPHA:
+        return 1;
+      default:
+        // Padding and orientation (horizontal)
+        return 0;
+    }
+  }
+
+  private static ViewGroup.LayoutParams layoutParams(View view) {
+    ViewGroup.LayoutParams params = view.getLayoutParams();
+    if (params == null) {
+      params = new ViewGroup.LayoutParams(
+        ViewGroup.LayoutParams.WRAP_CONTENT,
+        ViewGroup.LayoutParams.WRAP_CONTENT);
+    }
+    return params;
+  }
+}
@@ -0,0 +1,25 @@
+package com.slick.core;
+
+import android.text.Editable;
+import android.text.TextWatcher;
+
+// Text changes as deltas, only the inserted text crosses into Lua instead of
+// the whole buffer on every keystroke
+public class TextDeltaListener implements TextWatcher {
+  private long id;
+  private long key;
+
+  public TextDeltaListener(long id, long key) {
+    this.id = id;
+    this.key = key;
+  }
+
+  public void onTextChanged(CharSequence s, int start, int before, int count) {
+    String inserted = count > 0 ?
+      s.subSequence(start, start + count).toString() : "";
+    Lua.call("platform", "on_event", this.id, this.key, start, before, inserted);
+  }
+
+  public void afterTextChanged(Editable s) {}
+  public void beforeTextChanged(CharSequence s, int start, int count, int after) {}
+}
@@ -7,7 +7,7 @@ include $(PREBUILT_STATIC_LIBRARY)
 
 include $(CLEAR_VARS)
 LOCAL_MODULE := slick
-LOCAL_CFLAGS += -O3 -DNDEBUG -std=c99
+LOCAL_CFLAGS += -O3 -DNDEBUG -std=gnu99
 LOCAL_LDLIBS += -llog
 LOCAL_STATIC_LIBRARIES += libluajit
 LOCAL_SRC_FILES := bridge.c
@@ -1,9 +1,16 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <stdbool.h>
+#include <stdint.h>
 #include <jni.h>
 #include <android/log.h>
 #include <assert.h>
+#include <time.h>
+#include <string.h>
+#include <signal.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/syscall.h>
 
 #include "lua/lua.h"
 #include "lua/lualib.h"
@@ -11,6 +18,17 @@
 
 #define TAG "slick"
 #define LOCAL_FRAME_CAP 100
+#define PROFILE_DEPTH 64
+#define PROFILE_STACK_MAX 4096
+#define PROFILE_POLL 1000
+#define PROFILE_INTERVAL_US 1000
+#define IO_THREADS 2
+#define ASSET_CHUNK 65536
+#define ZIP_STORED 0
+
+#ifndef sigev_notify_thread_id
+#define sigev_notify_thread_id _sigev_un._tid
+#endif
 
 #define JNI(f, ...) (*jni_env)->f(jni_env, __VA_ARGS__)
 #define REF(o) JNI(NewGlobalRef, o)
@@ -45,15 +63,81 @@ typedef struct {
   void *data;
 } Reference;
 
+// Userdata view over a Java primitive array or a direct ByteBuffer, shares
+// the `ref` layout of Reference so views pass back to Java as is
+typedef struct {
+  jobject ref;
+  void *data;
+  jsize len;
+  char type;
+} ArrayView;
+
+// Streaming handle over a packaged entry, reads go through one reusable
+// Java and native buffer of ASSET_CHUNK bytes
+typedef struct {
+  jobject entry;
+  jobject stream;
+  jarray buffer;
+  char *data;
+  jlong size;
+  jlong pos;
+  bool stored;
+} Asset;
+
 typedef struct {
   bool is_varargs;
   size_t args_len;
   jclass args_type[];
 } MethodInfo;
 
+// Folded stack and the number of samples it was seen in
+typedef struct {
+  char *stack;
+  unsigned long hash;
+  unsigned long count;
+} Sample;
+
+// Async read, handed from the UI thread to an I/O thread and back
+typedef struct IORequest {
+  int id;
+  bool asset;
+  char *path;
+  char *data;
+  size_t size;
+  const char *error;
+  struct IORequest *next;
+} IORequest;
+
+typedef struct {
+  IORequest *first;
+  IORequest *last;
+} IOQueue;
+
+static JavaVM *jvm;
 static JNIEnv *jni_env;
 static lua_State *L;
 
+static struct {
+  pthread_mutex_t lock;
+  pthread_cond_t ready;
+  IOQueue requests;
+  IOQueue done;
+  int next_id;
+  bool started;
+} io = {PTHREAD_MUTEX_INITIALIZER, PTHREAD_COND_INITIALIZER};
+
+static struct {
+  bool running;
+  bool timer;
+  volatile sig_atomic_t due;
+  Sample *samples;
+  size_t size;
+  size_t n;
+  unsigned long total;
+  timer_t timer_id;
+  struct sigaction old_action;
+} profiler;
+
 static struct {
   jstring storage_path;
   jobject package;
@@ -68,6 +152,16 @@ static struct {
     jclass double_t;
     jclass bool_t;
   } Primitive;
+  struct {
+    jclass short_t;
+    jclass int_t;
+    jclass long_t;
+    jclass float_t;
+    jclass double_t;
+    jclass bool_t;
+    jclass byte_t;
+    jclass object_t;
+  } Array;
   struct {
     jclass class;
     jmethodID toString;
@@ -76,6 +170,8 @@ static struct {
     jclass class;
     jmethodID getConstructors;
     jmethodID getMethods;
+    jmethodID isArray;
+    jmethodID getComponentType;
   } Class;
   struct { jclass class; } String;
   struct {
@@ -126,6 +222,9 @@ static struct {
   struct {
     jclass class;
     jmethodID read;
+    jmethodID read_range;
+    jmethodID skip;
+    jmethodID close;
   } InputStream;
   struct {
     jclass class;
@@ -136,30 +235,98 @@ static struct {
   struct {
     jclass class;
     jmethodID getSize;
+    jmethodID getMethod;
   } ZipEntry;
+  struct { jclass class; } ByteBuffer;
+  struct {
+    jclass class;
+    jmethodID apply;
+    jmethodID set;
+  } Style;
 } cache;
 
 /* Helpers */
 
+static jobject to_java(lua_State *L, int index, jclass cls);
+
+#define FILL_ARRAY(type, new, set, get) { \
+  type *buf = malloc(sizeof(type) * (len ? len : 1)); \
+  for (jsize i = 0; i < len; i++) { \
+    lua_rawgeti(L, index, i + 1); \
+    buf[i] = (type)get(L, -1); \
+    lua_pop(L, 1); \
+  } \
+  arr = JNI(new, len); \
+  JNI(set, arr, 0, len, buf); \
+  free(buf); \
+}
+
+// Converts the Lua array at `index` into a Java array of type `cls`,
+// primitive arrays are filled with a single region copy
+static jobject to_java_array(lua_State *L, int index, jclass cls) {
+  if (index < 0) index = lua_gettop(L) + index + 1;
+  jsize len = lua_objlen(L, index);
+  jarray arr = 0;
+
+  if (EQUAL(cls, cache.Array.int_t))
+    FILL_ARRAY(jint, NewIntArray, SetIntArrayRegion, lua_tonumber)
+  else if (EQUAL(cls, cache.Array.float_t))
+    FILL_ARRAY(jfloat, NewFloatArray, SetFloatArrayRegion, lua_tonumber)
+  else if (EQUAL(cls, cache.Array.double_t))
+    FILL_ARRAY(jdouble, NewDoubleArray, SetDoubleArrayRegion, lua_tonumber)
+  else if (EQUAL(cls, cache.Array.long_t))
+    FILL_ARRAY(jlong, NewLongArray, SetLongArrayRegion, lua_tonumber)
+  else if (EQUAL(cls, cache.Array.short_t))
+    FILL_ARRAY(jshort, NewShortArray, SetShortArrayRegion, lua_tonumber)
+  else if (EQUAL(cls, cache.Array.byte_t))
+    FILL_ARRAY(jbyte, NewByteArray, SetByteArrayRegion, lua_tointeger)
+  else if (EQUAL(cls, cache.Array.bool_t))
+    FILL_ARRAY(jboolean, NewBooleanArray, SetBooleanArrayRegion,
+      lua_toboolean)
+  else if (JNI(CallBooleanMethod, cls, cache.Class.isArray)) {
+    // Object arrays (String[], ...) convert each item to the component type
+    jclass item_cls = JNI(CallObjectMethod, cls, cache.Class.getComponentType);
+    arr = JNI(NewObjectArray, len, item_cls, 0);
+    for (jsize i = 0; i < len; i++) {
+      lua_rawgeti(L, index, i + 1);
+      int type = lua_type(L, -1);
+      jobject val = to_java(L, -1, item_cls);
+      JNI(SetObjectArrayElement, arr, i, val);
+      // Only delete values created here, not the global refs of references
+      if (val && type != LUA_TTABLE && type != LUA_TUSERDATA) DELOCAL(val);
+      lua_pop(L, 1);
+    }
+    DELOCAL(item_cls);
+  }
+  else {
+    luaL_error(L, "Table value conversion not supported for non array type");
+  }
+  return arr;
+}
+
 static jobject to_java(lua_State *L, int index, jclass cls) {
   Reference *obj;
   switch(lua_type(L, index)) {
     case LUA_TNIL:
       break;
     case LUA_TNUMBER:
-      if (cls == cache.Short.class || cache.Primitive.short_t) {
+      if (EQUAL(cls, cache.Short.class) ||
+          EQUAL(cls, cache.Primitive.short_t)) {
         jshort val = (jshort)lua_tonumber(L, index);
         return JNI(NewObject, cache.Short.class, cache.Short.init, val);
       }
-      else if (cls == cache.Integer.class || cache.Primitive.int_t) {
+      else if (EQUAL(cls, cache.Integer.class) ||
+          EQUAL(cls, cache.Primitive.int_t)) {
         jint val = (jint)lua_tonumber(L, index);
         return JNI(NewObject, cache.Integer.class, cache.Integer.init, val);
       }
-      else if (cls == cache.Long.class || cache.Primitive.long_t) {
+      else if (EQUAL(cls, cache.Long.class) ||
+          EQUAL(cls, cache.Primitive.long_t)) {
         jlong val = (jlong)lua_tonumber(L, index);
         return JNI(NewObject, cache.Long.class, cache.Long.init, val);
       }
-      else if (cls == cache.Float.class || cache.Primitive.float_t) {
+      else if (EQUAL(cls, cache.Float.class) ||
+          EQUAL(cls, cache.Primitive.float_t)) {
         jfloat val = (jfloat)lua_tonumber(L, index);
         return JNI(NewObject, cache.Float.class, cache.Float.init, val);
       }
@@ -178,8 +345,7 @@ static jobject to_java(lua_State *L, int index, jclass cls) {
       obj = lua_touserdata(L, -1);
       lua_pop(L, 1);
       if (obj) return obj->ref;
-      luaL_error(L, "Table value conversion not yet supported");
-      break;
+      return to_java_array(L, index, cls);
     case LUA_TFUNCTION:
       luaL_error(L, "Function value conversion not yet supported");
       break;
@@ -214,8 +380,8 @@ static jclass to_java_type(lua_State *L, int index) {
       obj = lua_touserdata(L, -1);
       lua_pop(L, 1);
       if (obj) return JNI(GetObjectClass, obj->ref);
-      luaL_error(L, "Table value conversion not yet supported");
-      break;
+      // Plain tables are converted to whichever array type is expected
+      return cache.Array.object_t;
     case LUA_TFUNCTION:
       luaL_error(L, "Function value conversion not yet supported");
       break;
@@ -242,6 +408,40 @@ static Reference *push_reference(lua_State *L, jobject jobj, void *data) {
   return ref;
 }
 
+// Pushes primitive arrays and direct byte buffers as views, items are read
+// and written in place instead of copying the whole array. Bytes are exposed
+// unsigned.
+static bool push_view(lua_State *L, jobject obj, jclass cls) {
+  char type = 0;
+  void *data = 0;
+  jsize len = 0;
+
+  if (EQUAL(cls, cache.Array.int_t)) type = 'I';
+  else if (EQUAL(cls, cache.Array.float_t)) type = 'F';
+  else if (EQUAL(cls, cache.Array.double_t)) type = 'D';
+  else if (EQUAL(cls, cache.Array.long_t)) type = 'J';
+  else if (EQUAL(cls, cache.Array.short_t)) type = 'S';
+  else if (EQUAL(cls, cache.Array.byte_t)) type = 'B';
+  else if (EQUAL(cls, cache.Array.bool_t)) type = 'Z';
+  else if (JNI(IsInstanceOf, obj, cache.ByteBuffer.class)) {
+    data = JNI(GetDirectBufferAddress, obj);
+    if (!data) return false;
+    type = 'B';
+    len = JNI(GetDirectBufferCapacity, obj);
+  }
+  if (!type) return false;
+  if (!data) len = JNI(GetArrayLength, obj);
+
+  ArrayView *view = lua_newuserdata(L, sizeof(ArrayView));
+  view->ref = JNI(NewGlobalRef, obj);
+  view->data = data;
+  view->len = len;
+  view->type = type;
+  luaL_getmetatable(L, "array");
+  lua_setmetatable(L, -2);
+  return true;
+}
+
 static void push_java(lua_State *L, jobject obj) {
   if (!obj) {
     lua_pushnil(L);
@@ -265,7 +465,7 @@ static void push_java(lua_State *L, jobject obj) {
     bool r = JNI(CallBooleanMethod, obj, cache.Boolean.booleanValue);
     lua_pushboolean(L, r);
   }
-  else {
+  else if (!push_view(L, obj, cls)) {
     push_reference(L, obj, 0);
   }
   DELOCAL(cls);
@@ -309,9 +509,8 @@ static void get_methods(lua_State *L, jclass cls, bool constructor) {
     info->args_len = len;
 
     for (int i = 0; i < len; i++) {
-      // Global references won't be deleted, but this should be ok as we
-      // expect classes to not be GCed. We will also cache the
-      // imported class at the lua side
+      // Deleted with the method reference, once its class is trimmed from
+      // the import cache and collected
       info->args_type[i] = JNI_REF(GetObjectArrayElement, args_type, i);
     }
 
@@ -367,6 +566,17 @@ static Reference *select_method(lua_State *L, const char *name, int index) {
     int n = info->is_varargs ? info->args_len - 1 : num_args;
     for (int j = 0; j < n; j++) {
       if (!args_type[j]) continue;
+
+      // Plain tables (the cached handle itself, references to Object[] get
+      // their own) only convert to array parameters, not to Object
+      if (args_type[j] == cache.Array.object_t) {
+        if (JNI(CallBooleanMethod, info->args_type[j], cache.Class.isArray))
+          continue;
+        methods[i] = 0;
+        num_candidates--;
+        break;
+      }
+
       if (JNI(IsAssignableFrom, args_type[j], info->args_type[j])) continue;
 
       if (EQUAL(args_type[j], cache.Double.class) && (
@@ -482,7 +692,8 @@ static int log_info(lua_State *L) LOCAL ({
 })
 
 static int inflate(lua_State *L) LOCAL ({
-  jstring path = JNI(NewStringUTF, luaL_checkstring(L, 1));
+  const char *name = luaL_checkstring(L, 1);
+  jstring path = JNI(NewStringUTF, name);
   jobject zip_entry = JNI(CallObjectMethod,
     global.package, cache.ZipFile.getEntry, path);
 
@@ -491,15 +702,76 @@ static int inflate(lua_State *L) LOCAL ({
     return 1;
   }
 
-  size_t size = JNI(CallLongMethod, zip_entry, cache.ZipEntry.getSize);
-  jarray buffer = JNI(NewByteArray, size);
+  // -1 when the size is unknown, the buffer then grows while reading
+  jlong length = JNI(CallLongMethod, zip_entry, cache.ZipEntry.getSize);
+  size_t capacity = length > 0 ? (size_t)length : ASSET_CHUNK;
+  char *data = malloc(capacity);
+  if (!data) return luaL_error(L, "Out of memory");
+  jarray buffer = JNI(NewByteArray, ASSET_CHUNK);
   jobject stream = JNI(CallObjectMethod,
     global.package, cache.ZipFile.getInputStream, zip_entry);
-  JNI(CallIntMethod, stream, cache.InputStream.read, buffer);
+  if (!buffer || !stream || (*jni_env)->ExceptionCheck(jni_env)) {
+    (*jni_env)->ExceptionClear(jni_env);
+    free(data);
+    return luaL_error(L, "Error reading asset: %s", name);
+  }
+
+  // A single read may return less than asked for
+  size_t n = 0;
+  bool grown = true;
+  while (length < 0 || n < (size_t)length) {
+    if (n == capacity) {
+      char *more = realloc(data, capacity * 2);
+      if (!more) {
+        grown = false;
+        break;
+      }
+      data = more;
+      capacity *= 2;
+    }
+    jint want = capacity - n < ASSET_CHUNK ? capacity - n : ASSET_CHUNK;
+    jint read = JNI(CallIntMethod,
+      stream, cache.InputStream.read_range, buffer, 0, want);
+    if (read <= 0 || (*jni_env)->ExceptionCheck(jni_env)) break;
+    JNI(GetByteArrayRegion, buffer, 0, read, (jbyte *)data + n);
+    n += read;
+  }
 
-  char *data = JNI(GetByteArrayElements, buffer, 0);
-  lua_pushlstring(L, data, size);
-  JNI(ReleaseByteArrayElements, buffer, data, JNI_ABORT);
+  bool failed = (*jni_env)->ExceptionCheck(jni_env);
+  if (failed) (*jni_env)->ExceptionClear(jni_env);
+  JNI(CallVoidMethod, stream, cache.InputStream.close);
+  if ((*jni_env)->ExceptionCheck(jni_env)) (*jni_env)->ExceptionClear(jni_env);
+
+  if (failed || !grown) {
+    free(data);
+    if (!grown) return luaL_error(L, "Out of memory");
+    return luaL_error(L, "Error reading asset: %s", name);
+  }
+  lua_pushlstring(L, data, n);
+  free(data);
+  return 1;
+})
+
+static int open_asset(lua_State *L) LOCAL ({
+  jstring path = JNI(NewStringUTF, luaL_checkstring(L, 1));
+  jobject zip_entry = JNI(CallObjectMethod,
+    global.package, cache.ZipFile.getEntry, path);
+  if (!zip_entry) return 0;
+
+  Asset *asset = lua_newuserdata(L, sizeof(Asset));
+  memset(asset, 0, sizeof(Asset));
+  luaL_getmetatable(L, "asset");
+  lua_setmetatable(L, -2);
+
+  asset->data = malloc(ASSET_CHUNK);
+  if (!asset->data) return luaL_error(L, "Out of memory");
+  asset->entry = REF(zip_entry);
+  asset->stream = JNI_REF(CallObjectMethod,
+    global.package, cache.ZipFile.getInputStream, zip_entry);
+  asset->buffer = JNI_REF(NewByteArray, ASSET_CHUNK);
+  asset->size = JNI(CallLongMethod, zip_entry, cache.ZipEntry.getSize);
+  asset->stored =
+    JNI(CallIntMethod, zip_entry, cache.ZipEntry.getMethod) == ZIP_STORED;
   return 1;
 })
 
@@ -558,13 +830,656 @@ static int new(lua_State *L) LOCAL ({
   return 1;
 })
 
+static int clock_ms(lua_State *L) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  lua_pushnumber(L, ts.tv_sec * 1e3 + ts.tv_nsec / 1e6);
+  return 1;
+}
+
+static unsigned long hash_string(const char *s) {
+  unsigned long h = 2166136261u;
+  for (; *s; s++) h = (h ^ (unsigned char)*s) * 16777619u;
+  return h;
+}
+
+static Sample *find_sample(Sample *samples, size_t size, const char *stack,
+    unsigned long hash) {
+  size_t i = hash & (size - 1);
+  while (samples[i].stack) {
+    if (samples[i].hash == hash && !strcmp(samples[i].stack, stack))
+      break;
+    i = (i + 1) & (size - 1);
+  }
+  return &samples[i];
+}
+
+static void add_sample(const char *stack) {
+  // Keep the open addressed table at most half full
+  if ((profiler.n + 1) * 2 > profiler.size) {
+    size_t size = profiler.size ? profiler.size * 2 : 256;
+    Sample *samples = calloc(size, sizeof(Sample));
+    if (!samples) return;
+    for (size_t i = 0; i < profiler.size; i++) {
+      Sample *old = &profiler.samples[i];
+      if (old->stack) *find_sample(samples, size, old->stack, old->hash) = *old;
+    }
+    free(profiler.samples);
+    profiler.samples = samples;
+    profiler.size = size;
+  }
+
+  unsigned long hash = hash_string(stack);
+  Sample *sample = find_sample(profiler.samples, profiler.size, stack, hash);
+  if (!sample->stack) {
+    sample->stack = strdup(stack);
+    if (!sample->stack) return;
+    sample->hash = hash;
+    profiler.n++;
+  }
+  sample->count++;
+  profiler.total++;
+}
+
+static void free_samples(void) {
+  for (size_t i = 0; i < profiler.size; i++) free(profiler.samples[i].stack);
+  free(profiler.samples);
+  profiler.samples = NULL;
+  profiler.size = profiler.n = profiler.total = 0;
+}
+
+// Count hook, records the running stack root first as `a;b;c`. Hooks only
+// run in interpreted code, so under LuaJIT compiled traces show up as
+// their caller.
+static void profile_hook(lua_State *L, lua_Debug *ar) {
+  if (profiler.timer) {
+    if (!profiler.due) return;
+    profiler.due = 0;
+  }
+
+  int depth = 0;
+  lua_Debug frame;
+  while (depth < PROFILE_DEPTH && lua_getstack(L, depth, &frame)) depth++;
+
+  char stack[PROFILE_STACK_MAX];
+  size_t len = 0;
+  stack[0] = 0;
+  for (int level = depth - 1; level >= 0 && len < sizeof(stack); level--) {
+    lua_getstack(L, level, &frame);
+    lua_getinfo(L, "Sn", &frame);
+    const char *name = frame.name ? frame.name :
+      *frame.what == 'm' ? "main" : "?";
+    len += snprintf(stack + len, sizeof(stack) - len, "%s%s@%s:%d",
+      len ? ";" : "", name, frame.short_src, frame.linedefined);
+  }
+  if (len) add_sample(stack);
+}
+
+static void profile_signal(int sig) {
+  profiler.due = 1;
+}
+
+// Removes the hook and the timer, samples are kept
+static void profile_halt(lua_State *L) {
+  lua_sethook(L, NULL, 0, 0);
+  if (profiler.timer) {
+    timer_delete(profiler.timer_id);
+    sigaction(SIGPROF, &profiler.old_action, NULL);
+  }
+  profiler.running = false;
+}
+
+// Starts sampling, `mode` "time" samples every `interval` us of CPU time of
+// the calling thread, "count" every `interval` VM instructions. Hooks are
+// global to the state, so all of its coroutines are sampled.
+static int profile_start(lua_State *L) {
+  const char *mode = luaL_optstring(L, 1, "time");
+  if (profiler.running) return luaL_error(L, "Profiler already running");
+
+  free_samples();
+  profiler.timer = !strcmp(mode, "time");
+  if (profiler.timer) {
+    long interval = luaL_optinteger(L, 2, PROFILE_INTERVAL_US);
+    struct sigaction action;
+    memset(&action, 0, sizeof(action));
+    action.sa_handler = profile_signal;
+    action.sa_flags = SA_RESTART;
+    sigemptyset(&action.sa_mask);
+    sigaction(SIGPROF, &action, &profiler.old_action);
+
+    // Other threads, e.g. the I/O workers, neither advance the timer nor
+    // receive its signal
+    struct sigevent event;
+    memset(&event, 0, sizeof(event));
+    event.sigev_notify = SIGEV_THREAD_ID;
+    event.sigev_signo = SIGPROF;
+    event.sigev_notify_thread_id = syscall(SYS_gettid);
+    if (timer_create(CLOCK_THREAD_CPUTIME_ID, &event, &profiler.timer_id)) {
+      sigaction(SIGPROF, &profiler.old_action, NULL);
+      return luaL_error(L, "Cannot create profiler timer");
+    }
+
+    struct itimerspec timer = {
+      {interval / 1000000, interval % 1000000 * 1000},
+      {interval / 1000000, interval % 1000000 * 1000},
+    };
+    timer_settime(profiler.timer_id, 0, &timer, NULL);
+    lua_sethook(L, profile_hook, LUA_MASKCOUNT, PROFILE_POLL);
+  }
+  else if (!strcmp(mode, "count")) {
+    lua_sethook(L, profile_hook, LUA_MASKCOUNT,
+      luaL_optinteger(L, 2, PROFILE_POLL));
+  }
+  else {
+    return luaL_error(L, "Invalid profiler mode: %s", mode);
+  }
+
+  profiler.due = 0;
+  profiler.running = true;
+  return 0;
+}
+
+// Stops sampling and writes folded stacks, one `stack count` line each, to
+// `path` or profile.folded in the storage path. Returns the sample count
+// and the path.
+static int profile_stop(lua_State *L) {
+  if (!profiler.running) return luaL_error(L, "Profiler not running");
+  profile_halt(L);
+
+  if (lua_isnoneornil(L, 1)) {
+    lua_getglobal(L, "_internal");
+    lua_getfield(L, -1, "storage_path");
+    lua_pushstring(L, "/profile.folded");
+    lua_concat(L, 2);
+  }
+  else {
+    lua_pushvalue(L, 1);
+  }
+  const char *path = lua_tostring(L, -1);
+
+  FILE *f = fopen(path, "w");
+  if (!f) {
+    free_samples();
+    return luaL_error(L, "Cannot write profile: %s", path);
+  }
+  for (size_t i = 0; i < profiler.size; i++) {
+    Sample *sample = &profiler.samples[i];
+    if (sample->stack) fprintf(f, "%s %lu\n", sample->stack, sample->count);
+  }
+  fclose(f);
+  LOG("Profile: %lu samples, %zu stacks in %s",
+    profiler.total, profiler.n, path);
+
+  lua_pushnumber(L, profiler.total);
+  lua_insert(L, -2);
+  free_samples();
+  return 2;
+}
+
+static void io_push(IOQueue *queue, IORequest *r) {
+  r->next = NULL;
+  if (queue->last) queue->last->next = r;
+  else queue->first = r;
+  queue->last = r;
+}
+
+static IORequest *io_pop(IOQueue *queue) {
+  IORequest *r = queue->first;
+  if (r) {
+    queue->first = r->next;
+    if (!queue->first) queue->last = NULL;
+  }
+  return r;
+}
+
+// Reads a packaged entry on an I/O thread, `jni_env` is the thread's own
+static void io_read_asset(JNIEnv *jni_env, IORequest *r) {
+  JNI(PushLocalFrame, LOCAL_FRAME_CAP);
+  jstring path = JNI(NewStringUTF, r->path);
+  jobject zip_entry = JNI(CallObjectMethod,
+    global.package, cache.ZipFile.getEntry, path);
+  if (!zip_entry) {
+    r->error = "No such asset";
+    goto done;
+  }
+
+  // -1 when the size is unknown, byte arrays are limited to 2 GB
+  jlong length = JNI(CallLongMethod, zip_entry, cache.ZipEntry.getSize);
+  if (length < 0 || length > INT32_MAX) {
+    r->error = length < 0 ? "Unknown asset size" : "Asset too large";
+    goto done;
+  }
+  jsize size = (jsize)length;
+
+  jarray buffer = JNI(NewByteArray, size);
+  if (!buffer || (*jni_env)->ExceptionCheck(jni_env)) {
+    (*jni_env)->ExceptionClear(jni_env);
+    r->error = "Out of memory";
+    goto done;
+  }
+  jobject stream = JNI(CallObjectMethod,
+    global.package, cache.ZipFile.getInputStream, zip_entry);
+  if (!stream || (*jni_env)->ExceptionCheck(jni_env)) {
+    (*jni_env)->ExceptionClear(jni_env);
+    r->error = "Error reading asset";
+    goto done;
+  }
+
+  // A single read may return less than asked for
+  jsize n = 0;
+  while (n < size) {
+    jint read = JNI(CallIntMethod,
+      stream, cache.InputStream.read_range, buffer, n, size - n);
+    if (read < 0 || (*jni_env)->ExceptionCheck(jni_env)) break;
+    n += read;
+  }
+
+  bool failed = (*jni_env)->ExceptionCheck(jni_env);
+  if (failed) (*jni_env)->ExceptionClear(jni_env);
+  JNI(CallVoidMethod, stream, cache.InputStream.close);
+  if ((*jni_env)->ExceptionCheck(jni_env)) (*jni_env)->ExceptionClear(jni_env);
+
+  if (failed) {
+    r->error = "Error reading asset";
+  }
+  else if ((r->data = malloc(n ? n : 1))) {
+    JNI(GetByteArrayRegion, buffer, 0, n, (jbyte *)r->data);
+    r->size = n;
+  }
+  else {
+    r->error = "Out of memory";
+  }
+
+done:
+  JNI(PopLocalFrame, NULL);
+}
+
+static void io_read_file(IORequest *r) {
+  FILE *f = fopen(r->path, "rb");
+  if (!f) {
+    r->error = "Cannot open file";
+    return;
+  }
+
+  fseek(f, 0, SEEK_END);
+  long size = ftell(f);
+  fseek(f, 0, SEEK_SET);
+  if (size < 0 || !(r->data = malloc(size ? size : 1))) {
+    r->error = size < 0 ? "Cannot read file" : "Out of memory";
+  }
+  else {
+    r->size = fread(r->data, 1, size, f);
+  }
+  fclose(f);
+}
+
+static void *io_worker(void *arg) {
+  JNIEnv *env;
+  (*jvm)->AttachCurrentThread(jvm, &env, NULL);
+
+  pthread_mutex_lock(&io.lock);
+  while (true) {
+    IORequest *r;
+    while (!(r = io_pop(&io.requests))) {
+      pthread_cond_wait(&io.ready, &io.lock);
+    }
+    pthread_mutex_unlock(&io.lock);
+
+    if (r->asset) io_read_asset(env, r);
+    else io_read_file(r);
+
+    pthread_mutex_lock(&io.lock);
+    io_push(&io.done, r);
+  }
+  return NULL;
+}
+
+// Queues a read of a packaged entry ("asset") or a file ("file") on the I/O
+// threads, returns the request id to match with `poll_io` results
+static int read_async(lua_State *L) {
+  const char *kind = luaL_checkstring(L, 1);
+  const char *path = luaL_checkstring(L, 2);
+  if (strcmp(kind, "asset") && strcmp(kind, "file")) {
+    return luaL_error(L, "Invalid read kind: %s", kind);
+  }
+
+  IORequest *r = calloc(1, sizeof(IORequest));
+  if (!r || !(r->path = strdup(path))) {
+    free(r);
+    return luaL_error(L, "Out of memory");
+  }
+  r->asset = !strcmp(kind, "asset");
+
+  pthread_mutex_lock(&io.lock);
+  if (!io.started) {
+    for (int i = 0; i < IO_THREADS; i++) {
+      pthread_t thread;
+      pthread_create(&thread, NULL, io_worker, NULL);
+      pthread_detach(thread);
+    }
+    io.started = true;
+  }
+  r->id = ++io.next_id;
+  io_push(&io.requests, r);
+  pthread_cond_signal(&io.ready);
+  pthread_mutex_unlock(&io.lock);
+
+  lua_pushinteger(L, r->id);
+  return 1;
+}
+
+// Drops queued and completed reads, reads in flight still complete into the
+// queue but their ids are never reused
+static void io_clear(void) {
+  pthread_mutex_lock(&io.lock);
+  IORequest *r;
+  while ((r = io_pop(&io.requests)) || (r = io_pop(&io.done))) {
+    free(r->data);
+    free(r->path);
+    free(r);
+  }
+  pthread_mutex_unlock(&io.lock);
+}
+
+// Takes one finished read off the completion queue, returns its id and data
+// or nil and an error, nothing when the queue is empty
+static int poll_io(lua_State *L) {
+  pthread_mutex_lock(&io.lock);
+  IORequest *r = io_pop(&io.done);
+  pthread_mutex_unlock(&io.lock);
+  if (!r) return 0;
+
+  lua_pushinteger(L, r->id);
+  if (r->error) {
+    lua_pushnil(L);
+    lua_pushfstring(L, "%s: %s", r->error, r->path);
+  }
+  else {
+    lua_pushlstring(L, r->data, r->size);
+    lua_pushnil(L);
+  }
+  free(r->data);
+  free(r->path);
+  free(r);
+  return 3;
+}
+
+static Asset *check_asset(lua_State *L) {
+  Asset *asset = luaL_checkudata(L, 1, "asset");
+  if (!asset->stream) luaL_error(L, "Asset is closed");
+  return asset;
+}
+
+// Reads up to `n` bytes into the native buffer, returns the count or -1
+static jint asset_fill(Asset *asset, jint n) {
+  jint total = 0;
+  while (total < n) {
+    jint read = JNI(CallIntMethod, asset->stream,
+      cache.InputStream.read_range, asset->buffer, total, n - total);
+    if ((*jni_env)->ExceptionCheck(jni_env)) {
+      (*jni_env)->ExceptionClear(jni_env);
+      return -1;
+    }
+    if (read < 0) break;
+    total += read;
+  }
+  JNI(GetByteArrayRegion, asset->buffer, 0, total, (jbyte *)asset->data);
+  asset->pos += total;
+  return total;
+}
+
+// Pushes the next `n` bytes, nil at the end, nil and an error on failure
+static int push_chunk(lua_State *L, Asset *asset, lua_Integer n) {
+  if (n <= 0 || asset->pos >= asset->size) {
+    lua_pushnil(L);
+    return 1;
+  }
+
+  luaL_Buffer b;
+  luaL_buffinit(L, &b);
+  while (n > 0) {
+    jint read = asset_fill(asset, n < ASSET_CHUNK ? n : ASSET_CHUNK);
+    if (read < 0) {
+      lua_pushnil(L);
+      lua_pushstring(L, "Error reading asset");
+      return 2;
+    }
+    if (read == 0) break;
+    luaL_addlstring(&b, asset->data, read);
+    n -= read;
+  }
+  luaL_pushresult(&b);
+  return 1;
+}
+
+// asset:read([n]), next `n` bytes (ASSET_CHUNK by default)
+static int asset_read(lua_State *L) {
+  Asset *asset = check_asset(L);
+  return push_chunk(L, asset, luaL_optinteger(L, 2, ASSET_CHUNK));
+}
+
+static int asset_next(lua_State *L) {
+  Asset *asset = lua_touserdata(L, lua_upvalueindex(1));
+  if (!asset->stream) return 0;
+  return push_chunk(L, asset, lua_tointeger(L, lua_upvalueindex(2)));
+}
+
+// asset:chunks([n]), iterator over the rest of the entry in `n` byte chunks
+static int asset_chunks(lua_State *L) {
+  check_asset(L);
+  lua_settop(L, 1);
+  lua_pushinteger(L, luaL_optinteger(L, 2, ASSET_CHUNK));
+  lua_pushcclosure(L, asset_next, 2);
+  return 1;
+}
+
+// asset:seek([offset]), moves to byte `offset` and returns the position.
+// Cheap for stored entries, compressed ones inflate up to `offset` and
+// restart from the beginning when seeking backwards.
+static int asset_seek(lua_State *L) {
+  Asset *asset = check_asset(L);
+  if (lua_isnoneornil(L, 2)) {
+    lua_pushnumber(L, asset->pos);
+    return 1;
+  }
+
+  jlong offset = luaL_checknumber(L, 2);
+  if (offset < 0) offset = 0;
+  if (offset > asset->size) offset = asset->size;
+
+  if (offset < asset->pos) {
+    JNI(CallVoidMethod, asset->stream, cache.InputStream.close);
+    JNI(DeleteGlobalRef, asset->stream);
+    asset->stream = JNI_REF(CallObjectMethod,
+      global.package, cache.ZipFile.getInputStream, asset->entry);
+    asset->pos = 0;
+  }
+
+  while (asset->pos < offset) {
+    jlong skipped = JNI(CallLongMethod,
+      asset->stream, cache.InputStream.skip, offset - asset->pos);
+    if ((*jni_env)->ExceptionCheck(jni_env)) {
+      (*jni_env)->ExceptionClear(jni_env);
+      break;
+    }
+    if (skipped > 0) {
+      asset->pos += skipped;
+    }
+    else {
+      jlong left = offset - asset->pos;
+      if (asset_fill(asset, left < ASSET_CHUNK ? left : ASSET_CHUNK) <= 0)
+        break;
+    }
+  }
+
+  lua_pushnumber(L, asset->pos);
+  return 1;
+}
+
+static int asset_size(lua_State *L) {
+  Asset *asset = luaL_checkudata(L, 1, "asset");
+  lua_pushnumber(L, asset->size);
+  return 1;
+}
+
+static int asset_stored(lua_State *L) {
+  Asset *asset = luaL_checkudata(L, 1, "asset");
+  lua_pushboolean(L, asset->stored);
+  return 1;
+}
+
+static int asset_close(lua_State *L) {
+  Asset *asset = luaL_checkudata(L, 1, "asset");
+  if (asset->stream) {
+    JNI(CallVoidMethod, asset->stream, cache.InputStream.close);
+    if ((*jni_env)->ExceptionCheck(jni_env)) (*jni_env)->ExceptionClear(jni_env);
+    JNI(DeleteGlobalRef, asset->stream);
+    asset->stream = NULL;
+  }
+  if (asset->entry) JNI(DeleteGlobalRef, asset->entry);
+  if (asset->buffer) JNI(DeleteGlobalRef, asset->buffer);
+  free(asset->data);
+  asset->entry = asset->buffer = NULL;
+  asset->data = NULL;
+  return 0;
+}
+
 static int gc(lua_State *L) LOCAL ({
   Reference *obj = lua_touserdata(L, 1);
   JNI(DeleteGlobalRef, obj->ref);
-  if (obj->data) free(obj->data);
+  // Data is only set for method overloads, holding their argument classes
+  if (obj->data) {
+    MethodInfo *info = obj->data;
+    for (size_t i = 0; i < info->args_len; i++) {
+      JNI(DeleteGlobalRef, info->args_type[i]);
+    }
+    free(obj->data);
+  }
   return 0;
 })
 
+static int array_index(lua_State *L) {
+  ArrayView *view = luaL_checkudata(L, 1, "array");
+  jsize i = lua_tointeger(L, 2) - 1;
+  if (i < 0 || i >= view->len) return 0;
+
+  if (view->data) {
+    lua_pushinteger(L, ((unsigned char *)view->data)[i]);
+    return 1;
+  }
+
+  union { jint i; jfloat f; jdouble d; jlong j; jshort s; jbyte b;
+    jboolean z; } v;
+  switch (view->type) {
+    case 'I':
+      JNI(GetIntArrayRegion, view->ref, i, 1, &v.i);
+      lua_pushnumber(L, v.i);
+      break;
+    case 'F':
+      JNI(GetFloatArrayRegion, view->ref, i, 1, &v.f);
+      lua_pushnumber(L, v.f);
+      break;
+    case 'D':
+      JNI(GetDoubleArrayRegion, view->ref, i, 1, &v.d);
+      lua_pushnumber(L, v.d);
+      break;
+    case 'J':
+      JNI(GetLongArrayRegion, view->ref, i, 1, &v.j);
+      lua_pushnumber(L, v.j);
+      break;
+    case 'S':
+      JNI(GetShortArrayRegion, view->ref, i, 1, &v.s);
+      lua_pushnumber(L, v.s);
+      break;
+    case 'B':
+      JNI(GetByteArrayRegion, view->ref, i, 1, &v.b);
+      lua_pushinteger(L, (unsigned char)v.b);
+      break;
+    case 'Z':
+      JNI(GetBooleanArrayRegion, view->ref, i, 1, &v.z);
+      lua_pushboolean(L, v.z);
+      break;
+  }
+  return 1;
+}
+
+static int array_newindex(lua_State *L) {
+  ArrayView *view = luaL_checkudata(L, 1, "array");
+  jsize i = lua_tointeger(L, 2) - 1;
+  if (i < 0 || i >= view->len) {
+    return luaL_error(L, "Array index out of bounds: %d", i + 1);
+  }
+
+  if (view->data) {
+    ((unsigned char *)view->data)[i] = (unsigned char)lua_tointeger(L, 3);
+    return 0;
+  }
+
+  union { jint i; jfloat f; jdouble d; jlong j; jshort s; jbyte b;
+    jboolean z; } v;
+  switch (view->type) {
+    case 'I':
+      v.i = (jint)lua_tonumber(L, 3);
+      JNI(SetIntArrayRegion, view->ref, i, 1, &v.i);
+      break;
+    case 'F':
+      v.f = (jfloat)lua_tonumber(L, 3);
+      JNI(SetFloatArrayRegion, view->ref, i, 1, &v.f);
+      break;
+    case 'D':
+      v.d = (jdouble)lua_tonumber(L, 3);
+      JNI(SetDoubleArrayRegion, view->ref, i, 1, &v.d);
+      break;
+    case 'J':
+      v.j = (jlong)lua_tonumber(L, 3);
+      JNI(SetLongArrayRegion, view->ref, i, 1, &v.j);
+      break;
+    case 'S':
+      v.s = (jshort)lua_tonumber(L, 3);
+      JNI(SetShortArrayRegion, view->ref, i, 1, &v.s);
+      break;
+    case 'B':
+      v.b = (jbyte)lua_tointeger(L, 3);
+      JNI(SetByteArrayRegion, view->ref, i, 1, &v.b);
+      break;
+    case 'Z':
+      v.z = lua_toboolean(L, 3);
+      JNI(SetBooleanArrayRegion, view->ref, i, 1, &v.z);
+      break;
+  }
+  return 0;
+}
+
+static int array_len(lua_State *L) {
+  ArrayView *view = luaL_checkudata(L, 1, "array");
+  lua_pushinteger(L, view->len);
+  return 1;
+}
+
+static int array_gc(lua_State *L) {
+  ArrayView *view = lua_touserdata(L, 1);
+  JNI(DeleteGlobalRef, view->ref);
+  return 0;
+}
+
+// Applies a compiled Style.Plan to a view, all properties in one call
+static int apply_style(lua_State *L) {
+  Reference *view = lua_touserdata(L, 1);
+  Reference *plan = lua_touserdata(L, 2);
+  JNI(CallStaticVoidMethod,
+    cache.Style.class, cache.Style.apply, view->ref, plan->ref);
+  return 0;
+}
+
+static int set_style(lua_State *L) {
+  Reference *view = lua_touserdata(L, 1);
+  jint prop = luaL_checkinteger(L, 2);
+  jdouble value = luaL_checknumber(L, 3);
+  JNI(CallStaticVoidMethod,
+    cache.Style.class, cache.Style.set, view->ref, prop, value);
+  return 0;
+}
+
 static int invoke(lua_State *L) LOCAL ({
   const char *name = lua_tostring(L, 2);
   Reference *obj = lua_touserdata(L, 3);
@@ -579,14 +1494,9 @@ static int invoke(lua_State *L) LOCAL ({
   return 1;
 })
 
-/* JNI exports */
-
-JNIEXPORT unsigned long long JNICALL
-Java_com_slick_core_Lua_init(
-  JNIEnv *env, jclass cls, jstring j_apk_path, jstring j_storage_path)
-{
-  jni_env = env;
-
+// Classes and method ids stay valid for the process, they are looked up
+// once and kept across states
+static void cache_init(void) {
   // Cache classes
   cache.Object.class = JNI_REF(FindClass, "java/lang/Object");
   cache.Class.class = JNI_REF(FindClass, "java/lang/Class");
@@ -604,6 +1514,18 @@ Java_com_slick_core_Lua_init(
   cache.InputStream.class = JNI_REF(FindClass, "java/io/InputStream");
   cache.ZipFile.class = JNI_REF(FindClass, "java/util/zip/ZipFile");
   cache.ZipEntry.class = JNI_REF(FindClass, "java/util/zip/ZipEntry");
+  cache.ByteBuffer.class = JNI_REF(FindClass, "java/nio/ByteBuffer");
+  cache.Style.class = JNI_REF(FindClass, "com/slick/core/Style");
+
+  // Cache array classes
+  cache.Array.short_t = JNI_REF(FindClass, "[S");
+  cache.Array.int_t = JNI_REF(FindClass, "[I");
+  cache.Array.long_t = JNI_REF(FindClass, "[J");
+  cache.Array.float_t = JNI_REF(FindClass, "[F");
+  cache.Array.double_t = JNI_REF(FindClass, "[D");
+  cache.Array.bool_t = JNI_REF(FindClass, "[Z");
+  cache.Array.byte_t = JNI_REF(FindClass, "[B");
+  cache.Array.object_t = JNI_REF(FindClass, "[Ljava/lang/Object;");
 
   // Cache primitive classes
   cache.Primitive.short_t = JNI_REF(GetStaticObjectField,
@@ -648,6 +1570,10 @@ Java_com_slick_core_Lua_init(
     "getConstructors", "()[Ljava/lang/reflect/Constructor;");
   cache.Class.getMethods = JNI(GetMethodID, cache.Class.class,
     "getMethods", "()[Ljava/lang/reflect/Method;");
+  cache.Class.isArray = JNI(GetMethodID, cache.Class.class,
+    "isArray", "()Z");
+  cache.Class.getComponentType = JNI(GetMethodID, cache.Class.class,
+    "getComponentType", "()Ljava/lang/Class;");
   cache.Member.getName = JNI(GetMethodID, cache.Member.class,
     "getName", "()Ljava/lang/String;");
   cache.Constructor.getParameterTypes = JNI(GetMethodID, cache.Constructor.class,
@@ -664,6 +1590,12 @@ Java_com_slick_core_Lua_init(
     "invoke", "(Ljava/lang/Object;[Ljava/lang/Object;)Ljava/lang/Object;");
   cache.InputStream.read = JNI(GetMethodID, cache.InputStream.class,
     "read", "([B)I");
+  cache.InputStream.read_range = JNI(GetMethodID, cache.InputStream.class,
+    "read", "([BII)I");
+  cache.InputStream.skip = JNI(GetMethodID, cache.InputStream.class,
+    "skip", "(J)J");
+  cache.InputStream.close = JNI(GetMethodID, cache.InputStream.class,
+    "close", "()V");
   cache.ZipFile.init = JNI(GetMethodID, cache.ZipFile.class,
     "<init>", "(Ljava/lang/String;)V");
   cache.ZipFile.getEntry = JNI(GetMethodID, cache.ZipFile.class,
@@ -672,11 +1604,31 @@ Java_com_slick_core_Lua_init(
     "getInputStream", "(Ljava/util/zip/ZipEntry;)Ljava/io/InputStream;");
   cache.ZipEntry.getSize = JNI(GetMethodID, cache.ZipEntry.class,
     "getSize", "()J");
+  cache.ZipEntry.getMethod = JNI(GetMethodID, cache.ZipEntry.class,
+    "getMethod", "()I");
+  cache.Style.apply = JNI(GetStaticMethodID, cache.Style.class,
+    "apply", "(Landroid/view/View;Lcom/slick/core/Style$Plan;)V");
+  cache.Style.set = JNI(GetStaticMethodID, cache.Style.class,
+    "set", "(Landroid/view/View;ID)V");
+}
+
+/* JNI exports */
+
+JNIEXPORT unsigned long long JNICALL
+Java_com_slick_core_Lua_init(
+  JNIEnv *env, jclass cls, jstring j_apk_path, jstring j_storage_path)
+{
+  jni_env = env;
+  JNI(GetJavaVM, &jvm);
+  if (!cache.Object.class) cache_init();
 
-  // Global references
+  // Global references, the package stays open as I/O threads may still be
+  // reading from it
   global.storage_path = JNI(NewGlobalRef, j_storage_path);
-  global.package = JNI(NewGlobalRef,
-    JNI(NewObject, cache.ZipFile.class, cache.ZipFile.init, j_apk_path));
+  if (!global.package) {
+    global.package = JNI(NewGlobalRef,
+      JNI(NewObject, cache.ZipFile.class, cache.ZipFile.init, j_apk_path));
+  }
 
   L = luaL_newstate();
   luaL_openlibs(L);
@@ -685,14 +1637,30 @@ Java_com_slick_core_Lua_init(
   const luaL_Reg funcs[] = {
     {"log_info", log_info},
     {"inflate", inflate},
+    {"open_asset", open_asset},
     {"import", import},
     {"new", new},
     {"gc", gc},
     {"invoke", invoke},
+    {"apply_style", apply_style},
+    {"set_style", set_style},
+    {"clock", clock_ms},
+    {"profile_start", profile_start},
+    {"profile_stop", profile_stop},
+    {"read_async", read_async},
+    {"poll_io", poll_io},
     {NULL, NULL}
   };
   luaL_register(L, "_internal", funcs);
 
+  // App storage path, e.g. for state snapshots
+  const char *storage_path = JNI(GetStringUTFChars, j_storage_path, 0);
+  lua_getglobal(L, "_internal");
+  lua_pushstring(L, storage_path);
+  lua_setfield(L, -2, "storage_path");
+  lua_pop(L, 1);
+  JNI(ReleaseStringUTFChars, j_storage_path, storage_path);
+
   // Zip module loader
   luaL_dostring(L,
     "table.insert(package.loaders, function(module_name) "
@@ -714,14 +1682,66 @@ Java_com_slick_core_Lua_init(
   lua_pushcfunction(L, gc);
   lua_rawset(L, -3);
 
+  luaL_newmetatable(L, "array");
+  lua_pushstring(L, "__index");
+  lua_pushcfunction(L, array_index);
+  lua_rawset(L, -3);
+  lua_pushstring(L, "__newindex");
+  lua_pushcfunction(L, array_newindex);
+  lua_rawset(L, -3);
+  lua_pushstring(L, "__len");
+  lua_pushcfunction(L, array_len);
+  lua_rawset(L, -3);
+  lua_pushstring(L, "__gc");
+  lua_pushcfunction(L, array_gc);
+  lua_rawset(L, -3);
+
+  const luaL_Reg asset_methods[] = {
+    {"read", asset_read},
+    {"chunks", asset_chunks},
+    {"seek", asset_seek},
+    {"size", asset_size},
+    {"stored", asset_stored},
+    {"close", asset_close},
+    {NULL, NULL}
+  };
+  luaL_newmetatable(L, "asset");
+  lua_pushstring(L, "__index");
+  lua_newtable(L);
+  for (const luaL_Reg *m = asset_methods; m->name; m++) {
+    lua_pushcfunction(L, m->func);
+    lua_setfield(L, -2, m->name);
+  }
+  lua_rawset(L, -3);
+  lua_pushstring(L, "__gc");
+  lua_pushcfunction(L, asset_close);
+  lua_rawset(L, -3);
+
   lua_settop(L, 0);
 }
 
-JNIEXPORT void JNICALL
+// Message handler of host calls, errors keep the stack they were raised on
+static int traceback(lua_State *L)
+{
+  const char *msg = lua_tostring(L, 1);
+  if (!msg) {
+    msg = lua_pushfstring(L, "(error object is a %s value)",
+      luaL_typename(L, 1));
+  }
+  luaL_traceback(L, L, msg, 1);
+  return 1;
+}
+
+JNIEXPORT jobject JNICALL
 Java_com_slick_core_Lua_call(
   JNIEnv *env, jclass cls, jstring j_module, jstring j_func, jarray args)
 {
-  assert(L);
+  // Calls after destroy, e.g. from frame callbacks still posted, are dropped
+  if (!L) return 0;
+  // The state may have been created on the startup thread, calls come from
+  // one thread at a time but not always the same one
+  jni_env = env;
+  jobject result = 0;
   const char *module = JNI(GetStringUTFChars, j_module, 0);
   const char *func = JNI(GetStringUTFChars, j_func, 0);
 
@@ -740,26 +1760,53 @@ Java_com_slick_core_Lua_call(
     goto done;
   }
 
+  lua_pushcfunction(L, traceback);
+  lua_insert(L, -2);
+  int handler = lua_gettop(L) - 1;
+
   int num_args = JNI(GetArrayLength, args);
   for (int i = 0; i < num_args; i++) {
     jobject arg = JNI(GetObjectArrayElement, args, i);
     push_java(L, arg);
   }
 
-  if (lua_pcall(L, num_args, 0, 0)) {
+  if (lua_pcall(L, num_args, 1, handler)) {
     ERROR("Error calling: %s.%s", module, func);
     ERROR("%s", lua_tostring(L, -1));
     goto done;
   }
 
+  // Return value is only converted for Java objects and primitives
+  if (lua_type(L, -1) == LUA_TTABLE) {
+    lua_pushstring(L, "_ref");
+    lua_rawget(L, -2);
+    Reference *obj = lua_touserdata(L, -1);
+    if (obj) result = JNI(NewLocalRef, obj->ref);
+  }
+  else if (!lua_isnil(L, -1) && lua_type(L, -1) != LUA_TFUNCTION &&
+      lua_type(L, -1) != LUA_TTHREAD) {
+    result = to_java(L, -1, cache.Object.class);
+  }
+
 done:
   lua_settop(L, 0);
   JNI(ReleaseStringUTFChars, j_module, module);
   JNI(ReleaseStringUTFChars, j_func, func);
+  return result;
 }
 
 JNIEXPORT void JNICALL
 Java_com_slick_core_Lua_destroy(JNIEnv *env, jclass cls)
 {
+  if (!L) return;
+  jni_env = env;
+  if (profiler.running) profile_halt(L);
+  free_samples();
+  io_clear();
+
+  // Finalizers delete the global references of Java objects
   lua_close(L);
+  L = NULL;
+  JNI(DeleteGlobalRef, global.storage_path);
+  global.storage_path = 0;
 }
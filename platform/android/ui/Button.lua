@@ -17,6 +17,6 @@ controller {
   end,
 
   ['$new'] = function()
-    return Button(platform.activity)
+    return Button(platform.context)
   end
 }
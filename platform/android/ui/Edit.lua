@@ -1,8 +1,10 @@
 local platform = require('platform').is('android')
 local Observable = require('core.Observable')
+local Edit = require('platform.common.ui.Edit')
 
 local java = require('platform.android.java')
 local EditText = java.import('android.widget.EditText')
+local TextDeltaListener = java.import('com.slick.core.TextDeltaListener')
 
 
 controller {
@@ -12,6 +14,14 @@ controller {
     end
 
     scope.set_text(attr[1])
+
+    -- `deltas = true` only passes changed text from Java
+    if scope['$component'].args.deltas then
+      local id, key = platform.dispatch(scope, Edit.deltas(scope, attr))
+      scope['$element']:addTextChangedListener(TextDeltaListener(id, key))
+      return
+    end
+
     platform.event_listener(scope, 'addTextChangedListener', function(text)
       local watcher_id = scope['$watchers'].attr[1].id
       Observable.set_index(attr, 1, text, watcher_id)
@@ -23,6 +33,6 @@ controller {
   end,
 
   ['$new'] = function()
-    return EditText(platform.activity)
+    return EditText(platform.context)
   end
 }
@@ -3,15 +3,58 @@ local Panel = require('platform.common.ui.Panel')
 
 local java = require('platform.android.java')
 local LinearLayout = java.import('android.widget.LinearLayout')
+local ListView = java.import('android.widget.ListView')
+local ProgressBar = java.import('android.widget.ProgressBar')
 local LayoutParams = java.import('android.view.ViewGroup$LayoutParams')
+local LoopAdapter = java.import('com.slick.core.LoopAdapter')
+
+
+style {
+  Panel = {width = 'match', height = 'wrap', orientation = 'vertical'},
+}
 
 
 controller {
   function(loop)
     local element = scope['$element']
 
+    if scope['$component'].args.virtual then
+      -- Rows are recycled by the ListView, the adapter asks for a row
+      -- component to bind to `position` (1-based) for each recycled `row_id`
+      -- and for the entry count with position 0
+      local rows = {}
+      local adapter = LoopAdapter(platform.dispatch(scope,
+        function(position, row_id)
+          if position == 0 then
+            return Panel.refresh(scope)
+          end
+
+          local row = rows[row_id]
+          if not row then
+            row = Panel.new_row(scope)
+            rows[row_id] = row
+          end
+          Panel.bind_row(scope, row, position)
+          return row.element
+        end))
+
+      function scope.invalidate()
+        adapter:invalidate()
+      end
+
+      element:setLayoutParams(LayoutParams(-1, -1))
+      element:setAdapter(adapter)
+      platform.set_scrolls(scope)
+      Panel.init(attr, scope, loop)
+      return
+    end
+
     function scope.append_child(child)
-      element:addView(child.element)
+      if rawget(scope, '$placeholder') then
+        element:addView(child.element, element:getChildCount() - 1)
+      else
+        element:addView(child.element)
+      end
     end
 
     function scope.insert_child(child, idx)
@@ -22,19 +65,35 @@ controller {
       element:removeView(child.element)
     end
 
-    element:setOrientation(1)
-    element:setLayoutParams(LayoutParams(-1, -2))
+    -- Shown while the rest of the loop is built over the next frames
+    function scope.show_placeholder()
+      local placeholder = ProgressBar(platform.context)
+      element:addView(placeholder)
+      rawset(scope, '$placeholder', placeholder)
+    end
+
+    function scope.hide_placeholder()
+      element:removeView(rawget(scope, '$placeholder'))
+      rawset(scope, '$placeholder', nil)
+    end
 
     Panel.init(attr, scope, loop)
   end,
 
   [attr.loop] = Panel.watch,
 
-  ['$new'] = function()
-    return LinearLayout(platform.activity)
+  ['$new'] = function(component)
+    if component.args.virtual then
+      return ListView(platform.context)
+    end
+    return LinearLayout(platform.context)
   end,
 
   ['$destroy'] = function()
     Panel.clear(scope)
   end,
+
+  ['$suspend'] = Panel.suspend,
+  ['$resume'] = Panel.resume,
+  ['$configure'] = Panel.configure,
 }
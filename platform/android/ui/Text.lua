@@ -17,6 +17,6 @@ controller {
   end,
 
   ['$new'] = function()
-    return TextView(platform.activity)
+    return TextView(platform.context)
   end
 }
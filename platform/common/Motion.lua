@@ -0,0 +1,63 @@
+local platform = require('platform')
+local Scheduler = require('core.Scheduler')
+
+-- Coalesces pointer moves and scrolls into one delivery per frame, for hosts
+-- without a native path. Other actions ('down', 'up', 'cancel') are delivered
+-- right away, dropping a move still waiting for its frame. Velocities are in
+-- px per second, from the last two positions.
+local Motion = {}
+
+local COALESCED = {move = true, scroll = true}
+
+
+-- `deliver(action, x, y, vx, vy)` receives the events
+function Motion.new(deliver)
+  return {deliver = deliver, x = 0, y = 0, vx = 0, vy = 0}
+end
+
+
+function Motion.event(m, action, x, y)
+  local scheduler = platform.scheduler
+  local now = scheduler.clock()
+  if action == 'down' or not m.time then
+    m.vx, m.vy = 0, 0
+  elseif now > m.time then
+    m.vx = (x - m.x) / (now - m.time) * 1000
+    m.vy = (y - m.y) / (now - m.time) * 1000
+  end
+  m.x, m.y, m.time = x, y, now
+
+  if not COALESCED[action] or not Scheduler.is_driven(scheduler) then
+    if m.task then
+      Scheduler.cancel(scheduler, m.task)
+      m.task = nil
+    end
+    return m.deliver(action, x, y, m.vx, m.vy)
+  end
+
+  if m.task then return end
+  m.task = Scheduler.post(scheduler, function()
+    m.task = nil
+    m.deliver(action, m.x, m.y, m.vx, m.vy)
+  end, Scheduler.INPUT)
+end
+
+
+-- Binds touch and scroll of `component` to its `trigger`. They only cross
+-- into Lua when the parent listens, other elements keep native handling.
+function Motion.bind(component)
+  local events = rawget(component.scope, '$listeners')
+  if events.touch then
+    platform.touch_listener(component.scope, function(...)
+      component.env.trigger('touch', ...)
+    end)
+  end
+  if events.scroll then
+    platform.scroll_listener(component.scope, function(...)
+      component.env.trigger('scroll', ...)
+    end)
+  end
+end
+
+
+return Motion
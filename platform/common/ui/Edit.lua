@@ -0,0 +1,76 @@
+local platform = require('platform')
+local Observable = require('core.Observable')
+local Scheduler = require('core.Scheduler')
+local TextBuffer = require('core.TextBuffer')
+local Edit = {}
+
+
+-- Whether anyone besides the edit's own watcher needs the value
+local function needed(attr)
+  local slot = Observable.index(attr, 1)
+  if rawget(slot, '$subscribers') > 1 then return true end
+  local owner = rawget(slot, '$owner')
+  return owner ~= nil and Observable.interested(owner, rawget(slot, '$idx'))
+end
+
+
+-- Syncs of edits with buffered deltas, by delta handler
+local unsynced = setmetatable({}, {__mode = 'k'})
+
+-- Other listeners read the text from the attr, e.g. a submit button reading
+-- `scope.text`, so it is synced before they run even if nothing watches it
+platform.on_dispatch(function(listener)
+  for handler, sync in pairs(unsynced) do
+    if handler ~= listener then sync(true) end
+  end
+end)
+
+
+-- Binds the text of an edit in `deltas` mode. Returns the handler of
+-- `(start, before, inserted)` text deltas. Deltas go into a TextBuffer and
+-- `attr[1]` is synced from it at most once per frame while something else
+-- watches it, and before any other listener runs. `scope.value()` reads the
+-- current text.
+function Edit.deltas(scope, attr)
+  local buffer = TextBuffer.new(attr[1] ~= nil and tostring(attr[1]) or '')
+  local task, handler
+
+  local function sync(force)
+    if force ~= true then task = nil end
+    -- Reads through `scope.value()` apply the deltas but leave them unsynced
+    if not unsynced[handler] then return end
+    if not (force == true or needed(attr)) then return end
+    unsynced[handler] = nil
+    local watcher_id = scope['$watchers'].attr[1].id
+    Observable.set_index(attr, 1, TextBuffer.value(buffer), watcher_id)
+  end
+
+  function scope.value()
+    return TextBuffer.value(buffer)
+  end
+
+  -- Text set from the attr, its echo from the element is not a delta
+  local set_text = scope.set_text
+  function scope.set_text(text)
+    TextBuffer.set(buffer, tostring(text or ''))
+    unsynced[handler] = nil
+    rawset(scope, '$setting', true)
+    set_text(text)
+    rawset(scope, '$setting', nil)
+  end
+
+  function handler(start, before, inserted)
+    if rawget(scope, '$setting') then return end
+    TextBuffer.edit(buffer, start, before, inserted)
+    unsynced[handler] = sync
+
+    local scheduler = platform.scheduler
+    if not Scheduler.is_driven(scheduler) then return sync() end
+    if not task then
+      task = Scheduler.post(scheduler, sync, Scheduler.IDLE)
+    end
+  end
+  return handler
+end
+
+return Edit
@@ -1,10 +1,17 @@
 local platform = require('platform')
 local Observable = require('core.Observable')
 local Component = require('core.Component')
+local Scheduler = require('core.Scheduler')
 local Panel = {}
 
+-- Rows built beyond the visible window in virtual mode
+local OVERSCAN = 4
 
-function Panel.build_child(scope, idx, value, id)
+-- Loop children built right away when building is spread over frames
+local SYNC_ROWS = 16
+
+
+function Panel.new_child(scope, idx, value)
   local loop = Observable.new({key = idx, value = value})
   local as = {}
   if scope['$loop'] then
@@ -22,7 +29,12 @@ function Panel.build_child(scope, idx, value, id)
 
   local panel = 'platform.' .. platform.name .. '.ui.Panel'
   local child = Component.get(panel, nil, scope.args)
-  child = Component.build(child, scope['$parent'], loop)
+  return Component.build(child, scope['$parent'], loop)
+end
+
+
+function Panel.build_child(scope, idx, value, id)
+  local child = Panel.new_child(scope, idx, value)
 
   -- Create
   if not scope.children[idx] then
@@ -57,13 +69,93 @@ function Panel.delete_child(scope, idx)
   local child = scope.children[idx]
   if child then
     scope.remove_child(child)
-    Component.destroy(child)
+    Component.release(child)
     scope.children[idx] = nil
   end
 end
 
 
+-- Creates the child for a new `loop` entry. When the platform drives frames,
+-- up to `SYNC_ROWS` children per frame are built in place and the rest is
+-- queued and built in slices over the next frames, with a placeholder shown
+-- by the platform until the queue is empty.
+function Panel.add_child(scope, idx, value)
+  local scheduler = platform.scheduler
+  local building = rawget(scope, '$building')
+  if not Scheduler.is_driven(scheduler) then
+    return Panel.build_child(scope, idx, value)
+  end
+
+  if not building then
+    local sync = rawget(scope, '$sync')
+    if not sync or sync.frame ~= scheduler.frames then
+      sync = {frame = scheduler.frames, n = 0}
+      rawset(scope, '$sync', sync)
+    end
+    if sync.n < SYNC_ROWS then
+      sync.n = sync.n + 1
+      return Panel.build_child(scope, idx, value)
+    end
+
+    building = {order = {}, values = {}}
+    building.task = Scheduler.post(scheduler, function()
+      local i = 1
+      while building.order[i] ~= nil do
+        local idx = building.order[i]
+        local value = building.values[idx]
+        building.values[idx] = nil
+        i = i + 1
+        Panel.build_child(scope, idx, value)
+        coroutine.yield()
+      end
+      Panel.done_building(scope)
+    end, Scheduler.BUILD)
+    rawset(scope, '$building', building)
+    if scope.show_placeholder then scope.show_placeholder() end
+  end
+
+  if building.values[idx] == nil then
+    table.insert(building.order, idx)
+  end
+  building.values[idx] = value
+end
+
+
+function Panel.done_building(scope)
+  if not rawget(scope, '$building') then return end
+  rawset(scope, '$building', nil)
+  if rawget(scope, '$placeholder') then
+    scope.hide_placeholder()
+  end
+end
+
+
+-- Builds what is left in the queue, other loop changes apply to a complete
+-- set of children
+function Panel.finish_building(scope)
+  local building = rawget(scope, '$building')
+  if building then
+    Scheduler.finish(platform.scheduler, building.task)
+  end
+end
+
+
 function Panel.clear(scope)
+  local building = rawget(scope, '$building')
+  if building then
+    Scheduler.cancel(platform.scheduler, building.task)
+    Panel.done_building(scope)
+  end
+
+  local virtual = rawget(scope, '$virtual')
+  if virtual then
+    for _, row in ipairs(virtual.rows) do
+      Component.destroy(row)
+    end
+    virtual.rows, virtual.pool, virtual.bound = {}, {}, {}
+    return
+  end
+
   for idx in pairs(scope.children) do
     Panel.delete_child(scope, idx)
   end
@@ -71,19 +163,56 @@ function Panel.clear(scope)
 end
 
 
+-- Children built so far, rows of virtual panels included
+local function each_child(scope, f)
+  local virtual = rawget(scope, '$virtual')
+  if virtual then
+    for _, row in ipairs(virtual.rows) do f(row) end
+    return
+  end
+  for _, child in pairs(scope.children) do f(child) end
+end
+
+
+function Panel.suspend()
+  each_child(scope, Component.suspend)
+end
+
+
+function Panel.resume()
+  each_child(scope, Component.resume)
+end
+
+
+function Panel.configure(config)
+  each_child(scope, function(child)
+    Component.configure(child, config)
+  end)
+end
+
+
 function Panel.init(attr, scope, loop)
   scope.children = {}
   scope['$loop'] = loop
 
-  if scope['$component'].args.loop then
+  local args = scope['$component'].args
+  if args.loop then
     -- Loop container panel
-    scope.args = table.copy(scope['$component'].args)
+    scope.args = table.copy(args)
     assert(scope.args.loop)
     scope.args.loop = nil
 
+    if args.virtual then
+      scope.args.virtual = nil
+      scope.args.overscan = nil
+      scope.args.row_height = nil
+      Panel.init_virtual(scope, args)
+      return
+    end
+
     if type(attr.loop) == 'table' then
       for idx, v in pairs(attr.loop) do
-        Panel.build_child(scope, idx, v)
+        Panel.add_child(scope, idx, v)
       end
     end
   else
@@ -100,11 +229,22 @@ end
 
 
 function Panel.watch(value, idx, id)
+  if rawget(scope, '$virtual') then
+    scope.invalidate()
+    return
+  end
+
   if idx == nil then
     Panel.clear(scope)
     return
   end
 
+  if value ~= nil and id ~= table.insert and not scope.children[idx] then
+    Panel.add_child(scope, idx, value)
+    return
+  end
+
+  Panel.finish_building(scope)
   if value == nil then
     Panel.delete_child(scope, idx)
     return
@@ -114,4 +254,120 @@ function Panel.watch(value, idx, id)
 end
 
 
+-- Virtual loop panel
+--
+-- Only rows inside the visible window (plus overscan) are built. Rows that
+-- leave the window are kept in a pool and rebound to other `loop` entries
+-- instead of being destroyed, so memory and build time stay proportional to
+-- the window rather than the length of `attr.loop`.
+--
+-- Platforms provide `scope.invalidate()`, called whenever `attr.loop`
+-- changes. It should coalesce changes and later call `Panel.refresh` and
+-- rebind the visible rows, as the new values are only readable once the
+-- notification is over. Platforms windowing from Lua via `Panel.window` also
+-- provide `scope.place_row(row, idx)` and `scope.hide_row(row)`.
+
+function Panel.init_virtual(scope, args)
+  rawset(scope, '$virtual', {
+    rows = {},
+    pool = {},
+    bound = {},
+    count = 0,
+    overscan = args.overscan or OVERSCAN,
+  })
+  scope.invalidate()
+end
+
+
+function Panel.new_row(scope)
+  local virtual = rawget(scope, '$virtual')
+  local row = Panel.new_child(scope, 0, {})
+  rawset(row.scope['$loop'], '$proxy', row.scope['$loop'].value)
+  table.insert(virtual.rows, row)
+  return row
+end
+
+
+function Panel.bind_row(scope, row, idx)
+  local loop = row.scope['$loop']
+  local data = scope['$component'].attr.loop
+
+  Panel.unbind_row(row)
+  loop.key = idx
+
+  local value = data[idx]
+  if not (Observable.is_observable(value) and Observable.is_indexable(value)) then
+    loop.value = value
+    return
+  end
+
+  -- Copy entry fields into the row's own table so existing bindings inside
+  -- the row stay valid, then forward further writes to the entry
+  local proxy = rawget(loop, '$proxy')
+  for k, slot in Observable.spairs(proxy) do
+    if Observable.unwrap(slot) ~= nil and value[k] == nil then
+      proxy[k] = nil
+    end
+  end
+  for k, v in pairs(value) do
+    proxy[k] = v
+  end
+  if loop.value ~= proxy then
+    Observable.set(Observable.index(loop, 'value'), proxy)
+  end
+
+  local source = Observable.index(data, idx)
+  local function forward(v, k)
+    if k ~= nil then proxy[k] = v end
+  end
+  Observable.watch(source, nil, forward, row.scope)
+  rawset(loop, '$source', {source, forward})
+end
+
+
+function Panel.unbind_row(row)
+  local loop = row.scope['$loop']
+  local source = rawget(loop, '$source')
+  if source then
+    Observable.unwatch(source[1], nil, source[2])
+    rawset(loop, '$source', nil)
+  end
+end
+
+
+function Panel.refresh(scope)
+  local virtual = rawget(scope, '$virtual')
+  local data = scope['$component'].attr.loop
+  virtual.count = type(data) == 'table' and #data or 0
+  return virtual.count
+end
+
+
+function Panel.window(scope, first, last, rebind)
+  local virtual = rawget(scope, '$virtual')
+  first = math.max(first - virtual.overscan, 1)
+  last = math.min(last + virtual.overscan, virtual.count)
+
+  for idx, row in pairs(virtual.bound) do
+    if idx < first or idx > last then
+      virtual.bound[idx] = nil
+      Panel.unbind_row(row)
+      table.insert(virtual.pool, row)
+      if scope.hide_row then scope.hide_row(row) end
+    elseif rebind then
+      Panel.bind_row(scope, row, idx)
+    end
+  end
+
+  for idx = first, last do
+    if not virtual.bound[idx] then
+      local row = table.remove(virtual.pool) or Panel.new_row(scope)
+      Panel.bind_row(scope, row, idx)
+      virtual.bound[idx] = row
+      scope.place_row(row, idx)
+    end
+  end
+end
+
+
 return Panel
@@ -0,0 +1,306 @@
+local platform = require('platform').is('headless')
+local Component = require('core.Component')
+local Dispatcher = require('core.Dispatcher')
+local Scheduler = require('core.Scheduler')
+local Motion = require('platform.common.Motion')
+
+-- In-memory element tree for running components without a device or a
+-- browser. Every element operation is counted in `platform.ops`.
+
+local native_loadfile = loadfile
+local requests = 0
+
+local ASSET_CHUNK = 65536
+
+local Element = {}
+Element.__index = Element
+
+-- Asset handle over a plain file, mirrors the android one
+local Asset = {}
+Asset.__index = Asset
+
+platform.ops = {}
+platform.completions = {}
+
+
+local function count(op)
+  platform.ops[op] = (platform.ops[op] or 0) + 1
+end
+
+
+function platform.reset_ops()
+  platform.ops = {}
+end
+
+
+function platform.total_ops()
+  local n = 0
+  for _, v in pairs(platform.ops) do n = n + v end
+  return n
+end
+
+
+function platform.element(kind)
+  count('create')
+  return setmetatable({kind = kind, children = {}, listeners = {}}, Element)
+end
+
+
+function Element:append(child)
+  count('append')
+  table.insert(self.children, child)
+  child.parent = self
+end
+
+
+function Element:insert(child, idx)
+  count('insert')
+  table.insert(self.children, idx, child)
+  child.parent = self
+end
+
+
+function Element:remove(child)
+  count('remove')
+  for i, c in ipairs(self.children) do
+    if c == child then
+      table.remove(self.children, i)
+      break
+    end
+  end
+  child.parent = nil
+end
+
+
+function Element:set(name, value)
+  count('set')
+  self[name] = value
+end
+
+
+-- Style plans are the properties themselves, applying one is a single op
+function platform.compile_style(props)
+  local plan = {}
+  for name, value in pairs(props) do plan[name] = value end
+  return plan
+end
+
+
+function platform.apply_style(element, plan)
+  count('style')
+  for name, value in pairs(plan) do element[name] = value end
+end
+
+
+function platform.set_style(element, name, value)
+  element:set(name, value)
+end
+
+
+function platform.clear_style(element, names)
+  count('style')
+  for _, name in ipairs(names) do element[name] = nil end
+end
+
+
+function platform.loadfile(name)
+  if platform.root_path then
+    local f = native_loadfile(platform.root_path .. '/' .. name)
+    if f then return f end
+  end
+  return native_loadfile(name)
+end
+
+
+local function read(path)
+  local f, err = io.open(path, 'rb')
+  if not f then return nil, err end
+  local data = f:read('*a')
+  f:close()
+  return data
+end
+
+
+-- Reads in place but completes on the next frame, as the native I/O threads
+-- do on devices
+function platform.read_file_async(path)
+  if not platform.can_await() then return read(path) end
+  requests = requests + 1
+  table.insert(platform.completions, {requests, read(path)})
+  return platform.await(requests)
+end
+
+
+function platform.read_asset_async(name)
+  return platform.read_file_async((platform.root_path or '.') .. '/' .. name)
+end
+
+
+function platform.poll()
+  local completions = platform.completions
+  platform.completions = {}
+  for _, c in ipairs(completions) do
+    platform.complete(c[1], c[2], c[3])
+  end
+end
+
+
+function platform.open_asset(name)
+  local f = io.open((platform.root_path or '.') .. '/' .. name, 'rb')
+  if not f then return nil, 'No such asset: ' .. name end
+  local length = f:seek('end')
+  f:seek('set')
+  return setmetatable({file = f, length = length}, Asset)
+end
+
+
+function Asset:read(n)
+  assert(self.file, 'Asset is closed')
+  n = n or ASSET_CHUNK
+  if n <= 0 then return nil end
+  return self.file:read(n)
+end
+
+
+function Asset:chunks(n)
+  assert(self.file, 'Asset is closed')
+  return function()
+    if self.file then return self:read(n) end
+  end
+end
+
+
+function Asset:seek(offset)
+  assert(self.file, 'Asset is closed')
+  if not offset then return self.file:seek() end
+  return self.file:seek('set', math.max(0, math.min(offset, self.length)))
+end
+
+
+function Asset:size()
+  return self.length
+end
+
+
+function Asset:stored()
+  return true
+end
+
+
+function Asset:close()
+  if self.file then
+    self.file:close()
+    self.file = nil
+  end
+end
+
+
+function platform.push_component(component)
+  local component = Component.build(component)
+  platform.show_component(component)
+  return component
+end
+
+
+function platform.show_component(component)
+  platform.root = component
+end
+
+
+function platform.destroy_element(element)
+  if element then count('destroy') end
+end
+
+
+function platform.build(component)
+  if component.id then
+    -- Bind general events
+    platform.event_listener(component.scope, 'click', function()
+      component.env.trigger('click')
+    end)
+
+    Motion.bind(component)
+  end
+end
+
+
+function platform.dispatch(scope, listener)
+  local id, key = Dispatcher.assign(platform.dispatcher, listener)
+  scope['$dispatch'][id] = key
+  return id, key
+end
+
+
+function platform.event_listener(scope, event, listener)
+  local listeners = scope['$element'].listeners
+  if not listeners[event] then listeners[event] = {} end
+  table.insert(listeners[event], {platform.dispatch(scope, listener)})
+end
+
+
+-- Touch actions are fired as `platform.fire(element, 'touch', action, x, y)`,
+-- moves reach `listener(action, x, y, vx, vy)` once per frame
+function platform.touch_listener(scope, listener)
+  local motion = Motion.new(listener)
+  platform.event_listener(scope, 'touch', function(action, x, y)
+    return Motion.event(motion, action, x, y)
+  end)
+end
+
+
+-- Scrolls are fired as `platform.fire(element, 'scroll', x, y)`
+function platform.scroll_listener(scope, listener)
+  local motion = Motion.new(listener)
+  platform.event_listener(scope, 'scroll', function(x, y)
+    return Motion.event(motion, 'scroll', x or 0, y or 0)
+  end)
+end
+
+
+function platform.on_event(id, key, ...)
+  local listener = Dispatcher.get(platform.dispatcher, id, key)
+  if listener then
+    return platform.run(listener, ...)
+  end
+end
+
+
+-- Fires `event` on `element` the same way hosts call back into Lua
+function platform.fire(element, event, ...)
+  local result
+  for _, listener in ipairs(element.listeners[event] or {}) do
+    result = platform.on_event(listener[1], listener[2], ...)
+  end
+  return result
+end
+
+
+-- Runs frames with the fake clock until no scheduled work or async request
+-- is left, returns the number of frames
+function platform.flush(frame_ms)
+  local frames = 0
+  while platform.scheduler.n > 0 or platform.is_awaiting() do
+    platform.on_frame()
+    platform.clock.advance(frame_ms or 16)
+    frames = frames + 1
+  end
+  return frames
+end
+
+
+-- Drives the scheduler with frames, as hosts with frame callbacks do
+function platform.drive_frames(enabled)
+  platform.scheduler.request_frame = enabled ~= false and function() end or nil
+end
+
+
+function platform.bootstrap(root_path, storage_path)
+  loadfile = platform.loadfile
+  platform.root_path = root_path
+  platform.storage_path = storage_path or os.getenv('TMPDIR') or '/tmp'
+  platform.clock = Scheduler.fake_clock()
+  platform.scheduler.clock = platform.clock
+end
+
+
+return platform
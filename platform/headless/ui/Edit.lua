@@ -0,0 +1,35 @@
+local platform = require('platform').is('headless')
+local Observable = require('core.Observable')
+local Edit = require('platform.common.ui.Edit')
+
+
+controller {
+  function()
+    function scope.set_text(text)
+      scope['$element']:set('text', tostring(text or ''))
+    end
+
+    scope.set_text(attr[1])
+
+    -- Deltas are fired as `platform.fire(element, 'delta', start, before,
+    -- inserted)`, the element text is left to the host as on Android
+    if scope['$component'].args.deltas then
+      platform.event_listener(scope, 'delta', Edit.deltas(scope, attr))
+      return
+    end
+
+    platform.event_listener(scope, 'input', function(text)
+      scope['$element'].text = text
+      local watcher_id = scope['$watchers'].attr[1].id
+      Observable.set_index(attr, 1, text, watcher_id)
+    end)
+  end,
+
+  [attr[1]] = function(v)
+    scope.set_text(v)
+  end,
+
+  ['$new'] = function()
+    return platform.element('edit')
+  end,
+}
@@ -0,0 +1,99 @@
+local platform = require('platform').is('headless')
+local Scheduler = require('core.Scheduler')
+local Panel = require('platform.common.ui.Panel')
+
+-- Rows visible in the viewport of virtual panels
+local VIEWPORT_ROWS = 20
+
+
+controller {
+  function(loop)
+    local element = scope['$element']
+
+    if scope['$component'].args.virtual then
+      -- Rows are children of the element positioned by `top`, the viewport
+      -- is scrolled by setting `element.scroll` (rows) and firing 'scroll'
+      element.scroll = 0
+      element.viewport = VIEWPORT_ROWS
+
+      function scope.update_window(rebind)
+        local first = math.floor(element.scroll) + 1
+        Panel.window(scope, first, first + element.viewport - 1, rebind)
+      end
+
+      local pending = false
+      function scope.invalidate()
+        if pending then return end
+        pending = true
+        Scheduler.post(platform.scheduler, function()
+          pending = false
+          if not rawget(scope, '$virtual') then return end
+          element:set('count', Panel.refresh(scope))
+          scope.update_window(true)
+        end, Scheduler.INPUT)
+      end
+
+      function scope.place_row(row, idx)
+        row.element:set('top', idx)
+        row.element:set('hidden', false)
+        if row.element.parent ~= element then
+          element:append(row.element)
+        end
+      end
+
+      function scope.hide_row(row)
+        row.element:set('hidden', true)
+      end
+
+      platform.event_listener(scope, 'scroll', function()
+        scope.update_window()
+      end)
+      Panel.init(attr, scope, loop)
+      return
+    end
+
+    function scope.append_child(child)
+      local placeholder = rawget(scope, '$placeholder')
+      if placeholder then
+        element:insert(child.element, #element.children)
+      else
+        element:append(child.element)
+      end
+    end
+
+    function scope.insert_child(child, idx)
+      element:insert(child.element, idx)
+    end
+
+    function scope.remove_child(child)
+      element:remove(child.element)
+    end
+
+    function scope.show_placeholder()
+      local placeholder = platform.element('placeholder')
+      element:append(placeholder)
+      rawset(scope, '$placeholder', placeholder)
+    end
+
+    function scope.hide_placeholder()
+      element:remove(rawget(scope, '$placeholder'))
+      rawset(scope, '$placeholder', nil)
+    end
+
+    Panel.init(attr, scope, loop)
+  end,
+
+  [attr.loop] = Panel.watch,
+
+  ['$new'] = function()
+    return platform.element('panel')
+  end,
+
+  ['$destroy'] = function()
+    Panel.clear(scope)
+  end,
+
+  ['$suspend'] = Panel.suspend,
+  ['$resume'] = Panel.resume,
+  ['$configure'] = Panel.configure,
+}
@@ -0,0 +1,19 @@
+local platform = require('platform').is('headless')
+
+
+controller {
+  function()
+    function scope.set_text(text)
+      scope['$element']:set('text', tostring(text or ''))
+    end
+    scope.set_text(attr[1])
+  end,
+
+  [attr[1]] = function(v)
+    scope.set_text(v)
+  end,
+
+  ['$new'] = function()
+    return platform.element('text')
+  end,
+}
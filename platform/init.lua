@@ -1,12 +1,40 @@
 require('core.env')
 local Dispatcher = require('core.Dispatcher')
+local Scheduler = require('core.Scheduler')
 
 local MAX_DISPATCH_ITEMS = 1e6
 
 local platform = {
-  dispatcher = Dispatcher.new(MAX_DISPATCH_ITEMS)
+  dispatcher = Dispatcher.new(MAX_DISPATCH_ITEMS),
+  scheduler = Scheduler.new(),
+
+  -- Memory pressure levels, as Android's onTrimMemory reports them
+  TRIM = {
+    RUNNING_MODERATE = 5,
+    RUNNING_LOW = 10,
+    RUNNING_CRITICAL = 15,
+    UI_HIDDEN = 20,
+    BACKGROUND = 40,
+    MODERATE = 60,
+    COMPLETE = 80,
+  },
 }
 
+-- Functions releasing memory on pressure, see `platform.on_trim`
+local trimmers = {}
+
+-- Functions run before each listener, see `platform.on_dispatch`
+local dispatchers = {}
+
+-- Markers yielded by runner coroutines
+local DONE, WAIT = {}, {}
+
+-- Idle runner coroutines, the running one and the ones waiting on async
+-- requests by request id
+local idle = {}
+local current
+local waiting = {}
+
 
 function platform.set(name)
   assert(not platform.name, 'Platform already set:', platform.name)
@@ -23,11 +51,162 @@ function platform.is(name)
 end
 
 
+local function park(co, ...)
+  idle[#idle + 1] = co
+  return coroutine.yield(DONE, ...)
+end
+
+
+-- Runs functions passed to `resume` for as long as the coroutine lives
+local function serve(co, f, ...)
+  return serve(co, park(co, f(...)))
+end
+
+
+local function finish(co, previous, ok, marker, ...)
+  current = previous
+  if not ok then
+    if type(marker) == 'table' then
+      marker.traceback = debug.traceback(co)
+      error(marker)
+    end
+    error(debug.traceback(co, tostring(marker)), 0)
+  end
+  if marker == DONE then return ... end
+end
+
+
+local function resume(co, ...)
+  local previous = current
+  current = co
+  return finish(co, previous, coroutine.resume(co, ...))
+end
+
+
+-- Calls `f(...)` in a reusable coroutine, so it can wait on async requests.
+-- Returns the results of `f` when it finishes without waiting. Hosts run
+-- event listeners through here.
+function platform.run(f, ...)
+  for _, before in ipairs(dispatchers) do before(f) end
+  local co = table.remove(idle) or coroutine.create(function(...)
+    return serve(coroutine.running(), ...)
+  end)
+  return resume(co, f, ...)
+end
+
+
+-- Only the `platform.run` coroutine itself can wait, coroutines it resumes,
+-- such as scheduler tasks, would yield to their own resumer
+function platform.can_await()
+  return current ~= nil and coroutine.running() == current
+end
+
+
+-- Suspends the running `platform.run` call until request `id` completes,
+-- returns the results passed to `platform.complete`
+function platform.await(id)
+  assert(current, 'Not called from platform.run')
+  assert(coroutine.running() == current,
+    'Not called from the platform.run coroutine')
+  waiting[id] = current
+  Scheduler.request(platform.scheduler)
+  return coroutine.yield(WAIT)
+end
+
+
+function platform.complete(id, ...)
+  local co = waiting[id]
+  if not co then return end
+  waiting[id] = nil
+  resume(co, ...)
+end
+
+
+function platform.is_awaiting()
+  return next(waiting) ~= nil
+end
+
+
+-- Hands completed async requests to `platform.complete`, set by platforms
+function platform.poll()
+end
+
+
+-- Frame callback of the host, resumes completed requests once per frame and
+-- runs scheduled work within the frame budget
+function platform.on_frame()
+  platform.poll()
+  local n = Scheduler.frame(platform.scheduler)
+  if next(waiting) then Scheduler.request(platform.scheduler) end
+  return n
+end
+
+
+-- Registers `f(level)` to release cached memory on pressure, `level` is one
+-- of `platform.TRIM`
+function platform.on_trim(f)
+  table.insert(trimmers, f)
+end
+
+
+-- Registers `f(listener)`, called before `platform.run` runs `listener`,
+-- e.g. to write back input buffered by other listeners
+function platform.on_dispatch(f)
+  table.insert(dispatchers, f)
+end
+
+
+-- Whether `level` asks to release everything that can be rebuilt. Levels
+-- are not ordered by severity: UI_HIDDEN and BACKGROUND only mean the app
+-- left the screen, and are below RUNNING_CRITICAL.
+function platform.is_full_trim(level)
+  local TRIM = platform.TRIM
+  return level == TRIM.RUNNING_CRITICAL or level >= TRIM.MODERATE
+end
+
+
+-- Called by hosts on memory pressure. Runs the registered trimmers and a
+-- full collection, which also releases the Java references of collected
+-- objects, returns the Lua heap in KB before and after.
+function platform.trim_memory(level)
+  local before = collectgarbage('count')
+  for _, f in ipairs(trimmers) do f(level) end
+  -- Objects resurrected for finalizers are only freed by the second run
+  collectgarbage('collect')
+  collectgarbage('collect')
+  local after = collectgarbage('count')
+  print(string.format('Trim memory (level %d): Lua heap %.0f KB -> %.0f KB',
+    level, before, after))
+  return before, after
+end
+
+
+-- Called by hosts when the display changed but the component tree is kept,
+-- `config` has `orientation` ('portrait' or 'landscape'), `width` and
+-- `height` in dp. Components update their layout through `$configure`.
+function platform.configure(config)
+  platform.config = config
+  require('core.Navigator').configure(config)
+end
+
+
+-- Loads the framework and the component definitions of `entry` ahead of
+-- `platform.init`, hosts call it while their UI is still starting up
+function platform.preload(entry)
+  assert(platform.name, 'Platform not set')
+  loadfile = platform.loadfile
+  require('core.Navigator')
+  require('core.Component').preload(entry)
+end
+
+
 function platform.init(entry, ...)
   assert(platform.name, 'Platform not set')
   platform.bootstrap(...)
 
-  local status, err = xpcall(platform.push_component, function(err)
+  -- Loaded here, the navigator requires components which require platform
+  local Navigator = require('core.Navigator')
+  local status, err = xpcall(Navigator.push, function(err)
     return debug.traceback(err)
   end, entry)
 
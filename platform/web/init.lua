@@ -1,6 +1,21 @@
 local platform = require('platform').is('web')
 local Component = require('core.Component')
 local Dispatcher = require('core.Dispatcher')
+local Scheduler = require('core.Scheduler')
+local Motion = require('platform.common.Motion')
+
+-- Pointer event handlers by touch action
+local POINTER_EVENTS = {
+  down = 'onpointerdown',
+  move = 'onpointermove',
+  up = 'onpointerup',
+  cancel = 'onpointercancel',
+}
+
+-- Id of the last async request, and the requests completed since the last
+-- frame
+local requests = 0
+local completions = {}
 
 
 function platform.loadfile(name)
@@ -14,9 +29,134 @@ function platform.loadfile(name)
 end
 
 
+-- Fetches `url` with an asynchronous XHR from a `platform.run` call, in
+-- place otherwise. Completions are resumed on the next frame by `poll`.
+local function fetch(url)
+  local xhr = js.new(window.XMLHttpRequest)
+  if not platform.can_await() then
+    xhr:open('GET', url, false)
+    xhr:send()
+    if xhr.status ~= 200 then return nil, xhr.statusText .. ' ' .. url end
+    return xhr.responseText
+  end
+
+  requests = requests + 1
+  local id = requests
+  xhr:open('GET', url, true)
+  xhr.onloadend = function()
+    if xhr.status == 200 then
+      table.insert(completions, {id, xhr.responseText})
+    else
+      table.insert(completions, {id, nil, xhr.statusText .. ' ' .. url})
+    end
+    Scheduler.request(platform.scheduler)
+  end
+  xhr:send()
+  return platform.await(id)
+end
+
+
+-- Assets are served next to the modules, returns their contents or nil and
+-- an error
+function platform.read_asset_async(name)
+  return fetch(name)
+end
+
+
+-- Browsers have no file system, paths are fetched as URLs
+function platform.read_file_async(path)
+  return fetch(path)
+end
+
+
+function platform.poll()
+  local done = completions
+  completions = {}
+  for _, c in ipairs(done) do
+    platform.complete(c[1], c[2], c[3])
+  end
+end
+
+
+-- Style properties as CSS, by declaration name and `element.style` key
+local CSS = {
+  width = {'width', 'width'},
+  height = {'height', 'height'},
+  padding = {'padding', 'padding'},
+  background_color = {'background-color', 'backgroundColor'},
+  text_color = {'color', 'color'},
+  text_size = {'font-size', 'fontSize'},
+  alpha = {'opacity', 'opacity'},
+  orientation = {'flex-direction', 'flexDirection'},
+}
+
+
+local function css_value(name, value)
+  if name == 'width' or name == 'height' then
+    if value == -1 then return '100%' end
+    if value == -2 then return 'auto' end
+    return value .. 'px'
+  elseif name == 'padding' or name == 'text_size' then
+    return value .. 'px'
+  elseif name == 'background_color' or name == 'text_color' then
+    local a = math.floor(value / 0x1000000) % 0x100
+    local r = math.floor(value / 0x10000) % 0x100
+    local g = math.floor(value / 0x100) % 0x100
+    return string.format('rgba(%d,%d,%d,%.3f)', r, g, value % 0x100, a / 255)
+  elseif name == 'orientation' then
+    return value == 1 and 'column' or 'row'
+  end
+  return tostring(value)
+end
+
+
+-- Style plans are CSS text appended to the inline style of elements, which
+-- keeps the inline style set by ui modules
+function platform.compile_style(props)
+  local css = {}
+  for name, value in pairs(props) do
+    table.insert(css, CSS[name][1] .. ':' .. css_value(name, value) .. ';')
+  end
+  return table.concat(css)
+end
+
+
+function platform.apply_style(element, plan)
+  local style = element.style
+  style.cssText = style.cssText .. plan
+end
+
+
+function platform.set_style(element, name, value)
+  element.style[CSS[name][2]] = css_value(name, value)
+end
+
+
+-- Removes the declarations of a plan applied before, so the inline style
+-- does not grow with each reuse of a pooled element
+function platform.clear_style(element, names)
+  local style = element.style
+  for _, name in ipairs(names) do
+    style:removeProperty(CSS[name][1])
+  end
+end
+
+
 function platform.push_component(component)
-  local component, element = Component.build(component)
-  platform.root:appendChild(element)
+  local component = Component.build(component)
+  platform.show_component(component)
+  return component
+end
+
+
+-- Replaces the element shown under the root
+function platform.show_component(component)
+  local shown = platform.shown
+  if shown and shown.element then
+    platform.root:removeChild(shown.element)
+  end
+  platform.root:appendChild(component.element)
+  platform.shown = component
 end
 
 
@@ -26,25 +166,69 @@ function platform.build(component)
     platform.event_listener(component.scope, 'onclick', function()
       component.env.trigger('click')
     end)
+
+    Motion.bind(component)
   end
 end
 
 
-function platform.event_listener(scope, event, listener)
+function platform.dispatch(scope, listener)
   local id, key = Dispatcher.assign(platform.dispatcher, listener)
   scope['$dispatch'][id] = key
+  return id, key
+end
+
+
+function platform.event_listener(scope, event, listener)
+  local id, key = platform.dispatch(scope, listener)
   scope['$element'][event] = function(...)
     local listener = Dispatcher.get(platform.dispatcher, id, key)
     if listener then
-      listener(...)
+      platform.run(listener, ...)
     end
   end
 end
 
 
+-- Pointer moves reach `listener(action, x, y, vx, vy)` once per frame
+function platform.touch_listener(scope, listener)
+  local motion = Motion.new(listener)
+  for action, event in pairs(POINTER_EVENTS) do
+    platform.event_listener(scope, event, function(_, e)
+      Motion.event(motion, action, e.clientX, e.clientY)
+    end)
+  end
+end
+
+
+-- Added as an event listener, virtual panels own `onscroll`
+function platform.scroll_listener(scope, listener)
+  local motion = Motion.new(listener)
+  local element = scope['$element']
+  local id, key = platform.dispatch(scope, function()
+    Motion.event(motion, 'scroll', element.scrollLeft, element.scrollTop)
+  end)
+  element:addEventListener('scroll', function()
+    local listener = Dispatcher.get(platform.dispatcher, id, key)
+    if listener then
+      platform.run(listener)
+    end
+  end)
+end
+
+
 function platform.bootstrap(root)
   loadfile = platform.loadfile
   platform.root = root
+
+  -- Scheduled work runs in animation frames
+  local performance = js.global.performance
+  platform.scheduler.clock = function() return performance:now() end
+  platform.scheduler.request_frame = function()
+    js.global:requestAnimationFrame(function()
+      platform.on_frame()
+    end)
+  end
 end
 
 
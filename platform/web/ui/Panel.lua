@@ -1,11 +1,80 @@
 local platform = require('platform').is('web')
 local Panel = require('platform.common.ui.Panel')
+local Motion = require('platform.common.Motion')
+
+-- Default row height (px) of virtual panels
+local ROW_HEIGHT = 40
 
 
 controller {
   function(loop)
+    local element = scope['$element']
+
+    if scope['$component'].args.virtual then
+      -- Rows are absolutely positioned inside a spacer sized for all
+      -- entries, only the rows in the scrolled viewport are bound
+      local row_height = scope['$component'].args.row_height or ROW_HEIGHT
+      local spacer = js.global.document:createElement('div')
+      spacer.style.position = 'relative'
+      element:appendChild(spacer)
+
+      function scope.update_window(rebind)
+        local height = element.clientHeight
+        if height == 0 then height = js.global.innerHeight end
+        local first = math.floor(element.scrollTop / row_height) + 1
+        local last = math.ceil((element.scrollTop + height) / row_height)
+        Panel.window(scope, first, last, rebind)
+      end
+
+      local pending = false
+      function scope.invalidate()
+        if pending then return end
+        pending = true
+        js.global:setTimeout(function()
+          pending = false
+          if not rawget(scope, '$virtual') then return end
+          local n = Panel.refresh(scope)
+          spacer.style.height = (n * row_height) .. 'px'
+          scope.update_window(true)
+        end, 0)
+      end
+
+      function scope.place_row(row, idx)
+        local style = row.element.style
+        style.position = 'absolute'
+        style.width = '100%'
+        style.height = row_height .. 'px'
+        style.top = ((idx - 1) * row_height) .. 'px'
+        style.display = ''
+        if row.element.parentNode ~= spacer then
+          spacer:appendChild(row.element)
+        end
+      end
+
+      function scope.hide_row(row)
+        row.element.style.display = 'none'
+      end
+
+      element.style.overflowY = 'auto'
+      element.style.height = '100%'
+      -- The window follows the scroll position once per frame
+      local motion = Motion.new(function()
+        scope.update_window()
+      end)
+      platform.event_listener(scope, 'onscroll', function()
+        Motion.event(motion, 'scroll', 0, element.scrollTop)
+      end)
+      Panel.init(attr, scope, loop)
+      return
+    end
+
     function scope.append_child(child)
-      scope['$element']:appendChild(child.element)
+      local placeholder = rawget(scope, '$placeholder')
+      if placeholder then
+        element:insertBefore(child.element, placeholder)
+      else
+        element:appendChild(child.element)
+      end
     end
 
     function scope.insert_child(child, idx)
@@ -16,6 +85,19 @@ controller {
       scope['$element']:removeChild(child.element)
     end
 
+    -- Shown while the rest of the loop is built over the next frames
+    function scope.show_placeholder()
+      local placeholder = js.global.document:createElement('div')
+      placeholder.className = 'ui placeholder'
+      element:appendChild(placeholder)
+      rawset(scope, '$placeholder', placeholder)
+    end
+
+    function scope.hide_placeholder()
+      element:removeChild(rawget(scope, '$placeholder'))
+      rawset(scope, '$placeholder', nil)
+    end
+
     Panel.init(attr, scope, loop)
   end,
 
@@ -30,4 +112,8 @@ controller {
   ['$destroy'] = function()
     Panel.clear(scope)
   end,
+
+  ['$suspend'] = Panel.suspend,
+  ['$resume'] = Panel.resume,
+  ['$configure'] = Panel.configure,
 }
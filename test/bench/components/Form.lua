@@ -0,0 +1,7 @@
+view {
+  ui.Edit { scope.query },
+  ui.Text { scope.query },
+}
+
+controller {
+}
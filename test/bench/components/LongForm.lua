@@ -0,0 +1,7 @@
+view {
+  ui.Edit { scope.text, deltas = true },
+  ui.Text { scope.text },
+}
+
+controller {
+}
@@ -0,0 +1,19 @@
+view {
+  ui.Text:pad { scope.label },
+}
+
+controller {
+  function()
+    scope.deliveries = 0
+    scope.clicks = 0
+  end,
+
+  [id.pad.touch] = function(event, action, x, y, vx, vy)
+    scope.deliveries = scope.deliveries + 1
+    scope.label = action .. ' ' .. x .. ',' .. y
+  end,
+
+  [id.pad.click] = function()
+    scope.clicks = scope.clicks + 1
+  end,
+}
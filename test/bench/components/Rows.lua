@@ -0,0 +1,10 @@
+view {
+  ui.Panel { loop = scope.items,
+    ui.Text { loop.value.name },
+    ui.Button:select { loop.value.label },
+  },
+}
+
+controller {
+  [id.select.click] = function() end,
+}
@@ -0,0 +1,8 @@
+view {
+  ui.Panel { loop = scope.items, virtual = true,
+    ui.Text { loop.value.name },
+  },
+}
+
+controller {
+}
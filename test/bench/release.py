@@ -0,0 +1,68 @@
+# -*- coding: utf-8 -*-
+"""Compares benchmarks of debug and release packaged Lua modules
+
+Run from the repository root:
+
+    python test/bench/release.py [--lua lua] [scenario...]
+
+Packages core/ and platform/ both ways with the CLI transforms and runs
+test/bench/run.lua against each, printing the release speedup.
+"""
+
+import os
+import re
+import subprocess
+import sys
+import tempfile
+
+from argparse import ArgumentParser
+
+sys.path.insert(0, os.getcwd())
+import cli  # noqa: E402
+
+RESULT = re.compile(r'^(\w+)\s+([\d.]+)\s+(-?[\d.]+)\s+(\d+)$')
+
+
+def package(dst, release):
+    for name in ('core', 'platform'):
+        cli.copy_dir(name, os.path.join(dst, name), {},
+                     skip_dirs=[os.path.join('platform', 'android', 'native')],
+                     transform=cli.lua_transform(name, release))
+
+
+def run(lua, root, scenarios):
+    env = dict(os.environ)
+    env['LUA_PATH'] = '%s/?.lua;%s/?/init.lua;./?.lua' % (root, root)
+    out = subprocess.check_output([lua, 'test/bench/run.lua'] + scenarios,
+                                  env=env, universal_newlines=True)
+    results = {}
+    for line in out.splitlines():
+        match = RESULT.match(line)
+        if match:
+            results[match.group(1)] = float(match.group(2))
+    return results
+
+
+def main():
+    parser = ArgumentParser('release')
+    parser.add_argument('--lua', help='lua interpreter', default='lua')
+    parser.add_argument('scenarios', nargs='*')
+    args = parser.parse_args()
+
+    times = {}
+    with tempfile.TemporaryDirectory() as tmp:
+        for mode in ('debug', 'release'):
+            root = os.path.join(tmp, mode)
+            package(root, mode == 'release')
+            times[mode] = run(args.lua, root, args.scenarios)
+
+    print('%-20s %10s %10s %8s' % ('scenario', 'debug ms', 'release ms',
+                                   'speedup'))
+    for name, debug in times['debug'].items():
+        release = times['release'][name]
+        print('%-20s %10.1f %10.1f %7.2fx' % (name, debug, release,
+                                              debug / max(release, 0.1)))
+
+
+if __name__ == '__main__':
+    sys.exit(main())
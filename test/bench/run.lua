@@ -0,0 +1,267 @@
+-- Component benchmarks on the headless platform
+--
+-- Run from the repository root: `lua test/bench/run.lua [scenario...]`
+-- Reports time, retained Lua memory and element operations per scenario and
+-- exits with an error when one exceeds its threshold in thresholds.lua.
+
+local platform = require('platform').set('headless')
+local Component = require('core.Component')
+local Observable = require('core.Observable')
+local Navigator = require('core.Navigator')
+local Snapshot = require('core.Snapshot')
+local thresholds = require('test.bench.thresholds')
+
+platform.bootstrap('test/bench')
+
+local ROWS = 1000
+local VIRTUAL_ROWS = 10000
+local KEYSTROKES = 500
+local LONG_TEXT = 20000
+local ACCESS_ROUNDS = 20
+local TOUCH_FRAMES = 60
+local MOVES_PER_FRAME = 20
+local SNAPSHOT_NODES = 50000
+
+
+local function items(n, prefix)
+  local t = {}
+  for i = 1, n do
+    t[i] = {name = prefix .. i, label = 'select ' .. i}
+  end
+  return t
+end
+
+
+local function rows_panel(c)
+  return c.scope['$panel'].scope.children[1]
+end
+
+
+local scenarios = {}
+local order = {}
+
+local function scenario(name, setup, run)
+  scenarios[name] = {setup = setup, run = run}
+  table.insert(order, name)
+end
+
+
+scenario('build_rows', function()
+  return platform.push_component('components.Rows'), items(ROWS, 'row ')
+end, function(c, data)
+  c.scope.items = data
+  platform.flush()
+  assert(#rows_panel(c).scope.children == ROWS)
+  return c
+end)
+
+
+scenario('update_rows', function()
+  local c = platform.push_component('components.Rows')
+  c.scope.items = items(ROWS, 'row ')
+  platform.flush()
+  return c
+end, function(c)
+  local loop = rows_panel(c).attr.loop
+  for i = 1, ROWS do
+    loop[i].name = 'updated ' .. i
+  end
+  c.scope.items = items(ROWS, 'next ')
+  platform.flush()
+  return c
+end)
+
+
+scenario('build_virtual_rows', function()
+  return platform.push_component('components.VirtualRows'),
+    items(VIRTUAL_ROWS, 'row ')
+end, function(c, data)
+  c.scope.items = data
+  platform.flush()
+  local element = rows_panel(c).element
+  for i = 1, 100 do
+    element.scroll = i * 10
+    platform.fire(element, 'scroll')
+  end
+  return c
+end)
+
+
+scenario('type_edit', function()
+  return platform.push_component('components.Form')
+end, function(c)
+  local edit = c.scope['$panel'].scope.children[1]
+  local text = ''
+  for i = 1, KEYSTROKES do
+    text = text .. string.char(97 + i % 26)
+    platform.fire(edit.element, 'input', text)
+  end
+  assert(c.scope.query == text)
+  return c
+end)
+
+
+scenario('type_edit_deltas', function()
+  platform.drive_frames(true)
+  local c = platform.push_component('components.LongForm')
+  c.scope.text = string.rep('x', LONG_TEXT)
+  return c
+end, function(c)
+  local edit = c.scope['$panel'].scope.children[1]
+  for i = 1, KEYSTROKES do
+    platform.fire(edit.element, 'delta', LONG_TEXT + i - 1, 0, 'y')
+    -- A frame every 10 keystrokes, synced once per frame
+    if i % 10 == 0 then platform.flush() end
+  end
+  platform.drive_frames(false)
+  assert(#c.scope.text == LONG_TEXT + KEYSTROKES)
+  return c
+end)
+
+
+scenario('destroy_rows', function()
+  local c = platform.push_component('components.Rows')
+  c.scope.items = items(ROWS, 'row ')
+  platform.flush()
+  return c
+end, function(c)
+  Component.destroy(c)
+end)
+
+
+scenario('navigate_back', function()
+  Navigator.reset()
+  local c = Navigator.push('components.Rows')
+  c.scope.items = items(ROWS, 'row ')
+  platform.flush()
+  Navigator.push('components.Form')
+  -- Held while the rows are hidden
+  c.scope.items[1].name = 'changed'
+  return c
+end, function(c)
+  assert(Navigator.back())
+  platform.flush()
+  assert(Navigator.current() == c and platform.root == c)
+  assert(#rows_panel(c).scope.children == ROWS)
+  return c
+end)
+
+
+scenario('touch_moves', function()
+  platform.drive_frames(true)
+  return platform.push_component('components.Pad')
+end, function(c)
+  local element = c.scope['$panel'].scope.children[1].element
+  platform.fire(element, 'touch', 'down', 0, 0)
+  for frame = 1, TOUCH_FRAMES do
+    for i = 1, MOVES_PER_FRAME do
+      platform.fire(element, 'touch', 'move', frame, i)
+    end
+    platform.flush()
+  end
+  platform.fire(element, 'touch', 'up', TOUCH_FRAMES, 0)
+  platform.fire(element, 'click')
+  platform.drive_frames(false)
+
+  -- Moves reach the controller once per frame
+  assert(c.scope.deliveries == TOUCH_FRAMES + 2)
+  assert(c.scope.label == 'up ' .. TOUCH_FRAMES .. ',0')
+  -- Binding touch keeps the element's own click
+  assert(c.scope.clicks == 1)
+  return c
+end)
+
+
+local function access(o, round)
+  local n = 0
+  for i, item in Observable.inext, o.items, 0 do
+    item.name = item.label
+    if item.name then n = n + 1 end
+  end
+  o.items[round].label = 'round ' .. round
+  return n
+end
+
+
+scenario('observable_access', function()
+  -- Slots of a tree in use already exist
+  local o = Observable.new({items = items(ROWS, 'row ')})
+  access(o, 1)
+  return o
+end, function(o)
+  local n = 0
+  for round = 1, ACCESS_ROUNDS do
+    n = n + access(o, round)
+  end
+  assert(n == ROWS * ACCESS_ROUNDS)
+end)
+
+
+scenario('load_dataset', function()
+  return items(VIRTUAL_ROWS, 'row ')
+end, function(data)
+  -- `data` is shaped in place and stays referenced by the setup
+  local o = Observable.new({items = data})
+  assert(o.items[VIRTUAL_ROWS].name == 'row ' .. VIRTUAL_ROWS)
+end)
+
+
+scenario('restore_snapshot', function()
+  -- Rows of a name and a label, three nodes each
+  local n = math.floor(SNAPSHOT_NODES / 3)
+  local o = Observable.new({items = items(n, 'row ')})
+  return Snapshot.dump(o), n
+end, function(data, n)
+  local o = Observable.new(Snapshot.load(data))
+  assert(o.items[n].name == 'row ' .. n)
+  -- Lazy restore of one row
+  assert(Snapshot.load(data, {'items', n}).label == 'select ' .. n)
+end)
+
+
+local function measure(s)
+  local a, b = s.setup()
+  collectgarbage()
+  collectgarbage()
+  platform.reset_ops()
+  local memory = collectgarbage('count')
+  local start = os.clock()
+
+  local res = s.run(a, b)
+
+  local time = (os.clock() - start) * 1000
+  collectgarbage()
+  collectgarbage()
+  local result = {
+    time_ms = time,
+    memory_kb = collectgarbage('count') - memory,
+    ops = platform.total_ops(),
+  }
+  if res then Component.destroy(res) end
+  return result
+end
+
+
+local selected = {...}
+if #selected == 0 then selected = order end
+
+local failed = {}
+print(string.format('%-20s %10s %12s %10s', 'scenario', 'time ms',
+  'memory kb', 'ops'))
+for _, name in ipairs(selected) do
+  local s = assert(scenarios[name], 'No such scenario: ' .. name)
+  local result = measure(s)
+  print(string.format('%-20s %10.1f %12.1f %10d', name, result.time_ms,
+    result.memory_kb, result.ops))
+
+  for metric, max in pairs(thresholds[name] or {}) do
+    if result[metric] > max then
+      table.insert(failed, string.format('%s: %s %.1f > %.1f', name, metric,
+        result[metric], max))
+    end
+  end
+end
+
+if #failed > 0 then
+  error('Benchmark regressions:\n' .. table.concat(failed, '\n'), 0)
+end
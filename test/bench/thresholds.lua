@@ -0,0 +1,15 @@
+-- Regression thresholds per scenario, element ops are deterministic and
+-- kept tight, time and memory leave room for slower machines
+return {
+  build_rows = {time_ms = 2500, memory_kb = 60000, ops = 8000},
+  update_rows = {time_ms = 3000, memory_kb = 4000, ops = 15000},
+  build_virtual_rows = {time_ms = 1000, memory_kb = 5000, ops = 4300},
+  type_edit = {time_ms = 100, memory_kb = 1000, ops = 500},
+  type_edit_deltas = {time_ms = 100, memory_kb = 1000, ops = 100},
+  destroy_rows = {time_ms = 1000, memory_kb = 1000, ops = 6004},
+  navigate_back = {time_ms = 100, memory_kb = 1000, ops = 100},
+  touch_moves = {time_ms = 100, memory_kb = 1000, ops = 200},
+  observable_access = {time_ms = 2000, memory_kb = 1000, ops = 0},
+  load_dataset = {time_ms = 100, memory_kb = 1000, ops = 0},
+  restore_snapshot = {time_ms = 250, memory_kb = 1000, ops = 0},
+}
@@ -0,0 +1,85 @@
+require('core.env')
+local platform = require('platform').set('headless')
+
+-- Chunk size of reads without a length, as in the headless platform
+local CHUNK = 65536
+
+
+describe('Asset', function()
+  local dir = os.getenv('TMPDIR') or '/tmp'
+  local name = 'asset_spec.bin'
+  local data = string.rep('0123456789abcdef', CHUNK / 16 * 2) .. 'tail'
+
+  local f = assert(io.open(dir .. '/' .. name, 'wb'))
+  f:write(data)
+  f:close()
+
+  local function open()
+    local root_path = platform.root_path
+    platform.root_path = dir
+    local asset, err = platform.open_asset(name)
+    platform.root_path = root_path
+    return asset, err
+  end
+
+  it('should read across chunk boundaries', function()
+    local asset = open()
+    assert.is.equal(asset:size(), #data)
+    assert.is.equal(asset:read(), data:sub(1, CHUNK))
+    assert.is.equal(asset:read(CHUNK - 2), data:sub(CHUNK + 1, 2 * CHUNK - 2))
+    -- Short read at the end
+    assert.is.equal(asset:read(10), 'eftail')
+    assert.is.equal(asset:seek(), #data)
+
+    local parts = {}
+    asset:seek(0)
+    for chunk in asset:chunks(1000) do
+      assert.is_true(#chunk <= 1000)
+      table.insert(parts, chunk)
+    end
+    assert.is.equal(table.concat(parts), data)
+    asset:close()
+  end)
+
+  it('should clamp seeks to the asset', function()
+    local asset = open()
+    assert.is.equal(asset:seek(-5), 0)
+    assert.is.equal(asset:read(4), '0123')
+    assert.is.equal(asset:seek(#data + 100), #data)
+    assert.is.equal(asset:seek(#data - 4), #data - 4)
+    assert.is.equal(asset:read(), 'tail')
+    asset:close()
+  end)
+
+  it('should return nil after the end', function()
+    local asset = open()
+    asset:seek(#data)
+    assert.is_nil(asset:read())
+    assert.is_nil(asset:read(1))
+    assert.is_nil(asset:read(0))
+    asset:close()
+  end)
+
+  it('should fail on use after close', function()
+    local asset = open()
+    local chunks = asset:chunks(4)
+    assert.is.equal(chunks(), '0123')
+    asset:close()
+    asset:close()
+
+    assert.is_nil(chunks())
+    assert.has_error(function() asset:read() end, 'Asset is closed')
+    assert.has_error(function() asset:seek(0) end, 'Asset is closed')
+    assert.has_error(function() asset:chunks() end, 'Asset is closed')
+    assert.is.equal(asset:size(), #data)
+  end)
+
+  it('should report missing assets', function()
+    local root_path = platform.root_path
+    platform.root_path = dir
+    local asset, err = platform.open_asset('missing_asset_spec.bin')
+    platform.root_path = root_path
+    assert.is_nil(asset)
+    assert.is.equal(err, 'No such asset: missing_asset_spec.bin')
+  end)
+end)
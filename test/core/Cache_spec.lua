@@ -0,0 +1,53 @@
+require('core.env')
+local Cache = require('core.Cache')
+
+
+describe('Cache', function()
+  it('should be [Cache] instance', function()
+    local c = Cache.new()
+    assert.is.equal(getmetatable(c), Cache)
+    assert.is.equal(c.n, 0)
+  end)
+
+  it('should evict least recently used entries', function()
+    local evicted = {}
+    local c = Cache.new({max = 2, evict = function(k, v)
+      table.insert(evicted, k .. v)
+    end})
+    Cache.put(c, 'a', 1)
+    Cache.put(c, 'b', 2)
+    assert.is.equal(Cache.get(c, 'a'), 1)
+    Cache.put(c, 'c', 3)
+    assert.are.same(evicted, {'b2'})
+    assert.is_nil(Cache.get(c, 'b'))
+    assert.is.equal(c.n, 2)
+  end)
+
+  it('should bound total cost', function()
+    local evicted = {}
+    local c = Cache.new({max_cost = 10, evict = function(k)
+      table.insert(evicted, k)
+    end})
+    Cache.put(c, 'a', true, 4)
+    Cache.put(c, 'b', true, 4)
+    Cache.put(c, 'c', true, 4)
+    assert.are.same(evicted, {'a'})
+    assert.is.equal(c.cost, 8)
+
+    Cache.trim(c, 4)
+    assert.are.same(evicted, {'a', 'b'})
+    Cache.clear(c)
+    assert.are.same(evicted, {'a', 'b', 'c'})
+    assert.is.equal(c.cost, 0)
+  end)
+
+  it('should take entries without evicting them', function()
+    local evicted = 0
+    local c = Cache.new({evict = function() evicted = evicted + 1 end})
+    Cache.put(c, 'a', 1, 5)
+    assert.is.equal(Cache.take(c, 'a'), 1)
+    assert.is_nil(Cache.take(c, 'a'))
+    assert.is.equal(c.cost, 0)
+    assert.is.equal(evicted, 0)
+  end)
+end)
@@ -0,0 +1,110 @@
+require('core.env')
+local platform = require('platform').set('headless')
+local Component = require('core.Component')
+local Observable = require('core.Observable')
+
+platform.bootstrap('test/core')
+
+
+local function rows(c)
+  return c.scope['$panel'].scope.children[1]
+end
+
+
+local function row(list, idx)
+  return list.scope.children[idx].scope.children[1]
+end
+
+
+describe('Component pool', function()
+  it('should reuse released instances with new args', function()
+    local c = platform.push_component('components.PoolList')
+    local list = rows(c)
+    local first = row(list, 1)
+    assert.is.equal(first.scope.key, 1)
+    assert.is.equal(first.attr.label, 'a')
+
+    list.attr.loop[1] = nil
+    assert.is.equal(first.scope.resets, 1)
+
+    list.attr.loop[4] = {name = 'd'}
+    local reused = row(list, 4)
+    assert.is.equal(reused, first)
+    -- The constructor runs again with the loop of the new use
+    assert.is.equal(reused.scope.built, 2)
+    assert.is.equal(reused.scope.key, 4)
+    assert.is.equal(reused.scope.last, 'd')
+    assert.is.equal(reused.element.children[1].text, 'd')
+
+    -- Bindings follow the new loop entry both ways
+    list.attr.loop[4].name = 'e'
+    assert.is.equal(reused.attr.label, 'e')
+    reused.attr.label = 'f'
+    assert.is.equal(list.attr.loop[4].name, 'f')
+    Component.destroy(c)
+  end)
+
+  it('should bound the pool and count its use', function()
+    local c = platform.push_component('components.PoolList')
+    local list = rows(c)
+    local before = Component.pool_stats()['components.PoolRow']
+    local hits, misses, dropped = before.hits, before.misses, before.dropped
+
+    for idx = 1, 3 do list.attr.loop[idx] = nil end
+    local stats = Component.pool_stats()['components.PoolRow']
+    assert.is.equal(stats.size, 2)
+    assert.is.equal(stats.max, 2)
+    assert.is.equal(stats.dropped, dropped + 1)
+
+    for idx = 1, 3 do list.attr.loop[idx] = {name = 'x' .. idx} end
+    stats = Component.pool_stats()['components.PoolRow']
+    assert.is.equal(stats.size, 0)
+    assert.is.equal(stats.hits, hits + 2)
+    assert.is.equal(stats.misses, misses + 1)
+    assert.is.equal(stats.hit_rate, stats.hits / (stats.hits + stats.misses))
+    assert.is.equal(row(list, 3).element.children[1].text, 'x3')
+    Component.destroy(c)
+  end)
+
+  it('should keep free instances until reused or trimmed', function()
+    local c = platform.push_component('components.PoolList')
+    local list = rows(c)
+    list.attr.loop[1] = nil
+    collectgarbage('collect')
+    local stats = Component.pool_stats()['components.PoolRow']
+    assert.is.equal(stats.size, 1)
+
+    -- Leaving the app keeps pools for instant back
+    Component.trim(platform.TRIM.UI_HIDDEN)
+    Component.trim(platform.TRIM.BACKGROUND)
+    stats = Component.pool_stats()['components.PoolRow']
+    assert.is.equal(stats.size, 1)
+
+    Component.trim(platform.TRIM.COMPLETE)
+    stats = Component.pool_stats()['components.PoolRow']
+    assert.is.equal(stats.size, 0)
+
+    -- Rows still in use release into the pool that stays listed
+    list.attr.loop[2] = nil
+    collectgarbage('collect')
+    stats = Component.pool_stats()['components.PoolRow']
+    assert.is.equal(stats.size, 1)
+    Component.destroy(c)
+  end)
+end)
+
+
+describe('Component computed values', function()
+  it('should stop following their sources on destroy', function()
+    local source = Observable.new({a = 1, b = 2})
+    local c = Component.build('components.Summary', nil, source)
+    local a = Observable.index(source, 'a')
+    assert.is.equal(c.scope.total, 3)
+    source.a = 2
+    assert.is.equal(c.scope.total, 4)
+    assert.is.equal(rawget(a, '$subscribers'), 1)
+
+    Component.destroy(c)
+    assert.is.equal(rawget(a, '$subscribers'), 0)
+  end)
+end)
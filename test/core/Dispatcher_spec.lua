@@ -68,10 +68,17 @@ describe('Dispatcher', function()
     assert.is.equal(Dispatcher.get(d, a, a_key), 1)
     assert.is.equal(d.n, 1)
 
-    b = Dispatcher.assign(d, 3)
+    local c, c_key = Dispatcher.assign(d, 3)
+    assert.is.equal(c, b)
+    assert.is_not.equal(c_key, b_key)
     assert.is.equal(Dispatcher.get(d, a, a_key), 1)
-    assert.is.equal(Dispatcher.get(d, b, b_key), 3)
+    assert.is.equal(Dispatcher.get(d, c, c_key), 3)
     assert.is.equal(d.n, 2)
+
+    -- The handle of the released item does not reach the new one
+    assert.has_error(function() Dispatcher.get(d, b, b_key) end,
+      'Invalid key')
+    assert.is.equal(Dispatcher.stats(d).stale, 1)
   end)
 
   it('should prevent access to items that no longer exist', function()
@@ -105,4 +112,48 @@ describe('Dispatcher', function()
     assert.is.equal(Dispatcher.remove(d, a, a_key), 1)
     assert.is.equal(d.n, 0)
   end)
+
+  it('should reuse released ids when dense', function()
+    local d = Dispatcher.new(3)
+    local a, a_key = Dispatcher.assign(d, 1)
+    local b, b_key = Dispatcher.assign(d, 2)
+    local c, c_key = Dispatcher.assign(d, 3)
+
+    assert.is.equal(Dispatcher.remove(d, b, b_key), 2)
+    local e, e_key = Dispatcher.assign(d, 4)
+    assert.is.equal(e, b)
+    assert.is.equal(Dispatcher.get(d, e, e_key), 4)
+    assert.is.equal(Dispatcher.get(d, a, a_key), 1)
+    assert.is.equal(Dispatcher.get(d, c, c_key), 3)
+  end)
+
+  it('should remove items in bulk', function()
+    local d = Dispatcher.new(4)
+    local handles = {}
+    for i = 1, 3 do
+      local id, key = Dispatcher.assign(d, i)
+      handles[id] = key
+    end
+    local a, a_key = Dispatcher.assign(d, 4)
+
+    assert.is.equal(Dispatcher.remove_all(d, handles), 3)
+    assert.is.equal(d.n, 1)
+    assert.is.equal(Dispatcher.get(d, a, a_key), 4)
+    for id, key in pairs(handles) do
+      assert.has_error(function() Dispatcher.get(d, id, key) end, 'No item')
+    end
+  end)
+
+  it('should count stale accesses', function()
+    local d = Dispatcher.new(2)
+    local a, a_key = Dispatcher.assign(d, 1)
+    Dispatcher.get(d, a, a_key)
+    assert.is.equal(Dispatcher.stats(d).stale, 0)
+    assert.is.equal(Dispatcher.stats(d).occupancy, 0.5)
+
+    Dispatcher.remove(d, a, a_key)
+    assert.has_error(function() Dispatcher.get(d, a, a_key) end, 'No item')
+    assert.is.equal(Dispatcher.remove_all(d, {[a] = a_key}), 0)
+    assert.is.equal(Dispatcher.stats(d).stale, 2)
+  end)
 end)
@@ -0,0 +1,28 @@
+require('core.env')
+local platform = require('platform').set('headless')
+
+platform.bootstrap('test/core')
+
+
+describe('Edit deltas', function()
+  it('should sync the text before other listeners read it', function()
+    platform.drive_frames(true)
+    local c = platform.push_component('components.Search')
+    c.scope.text = 'ab'
+    local children = c.scope['$panel'].scope.children
+    local edit, submit = children[1], children[2]
+
+    -- Nothing watches the text, deltas stay buffered
+    platform.fire(edit.element, 'delta', 2, 0, 'c')
+    platform.fire(edit.element, 'delta', 3, 0, 'd')
+    assert.is.equal(edit.scope.value(), 'abcd')
+    assert.is.equal(c.scope.text, 'ab')
+
+    platform.fire(submit.element, 'click')
+    assert.is.equal(c.scope.submitted, 'abcd')
+    assert.is.equal(c.scope.text, 'abcd')
+
+    platform.flush()
+    platform.drive_frames(false)
+  end)
+end)
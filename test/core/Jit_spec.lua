@@ -0,0 +1,57 @@
+require('core.env')
+local Jit = require('core.Jit')
+
+
+describe('Jit', function()
+  it('should count trace events', function()
+    local attached
+    local fake = {attach = function(f, what) attached = what and f end}
+    local funcs = {}
+    package.loaded['jit.util'] = {funcinfo = function(func, pc)
+      return funcs[func] and {loc = funcs[func] .. ':' .. pc} or {ffid = 7}
+    end}
+    package.loaded['jit.vmdef'] = {traceerr = {[3] = 'NYI: %s'}}
+    local hot, cold = function() end, function() end
+    funcs[hot], funcs[cold] = 'hot.lua', 'cold.lua'
+
+    rawset(_G, 'jit', fake)
+    local ok = Jit.start()
+    rawset(_G, 'jit', nil)
+    assert.is_true(ok)
+
+    attached('start', 1, hot, 10)
+    attached('stop', 1)
+    attached('start', 2, cold, 5)
+    attached('abort', 2, cold, 6, 3, 'FastFunc next')
+    attached('start', 3, cold, 5)
+    attached('abort', 3, print, 0, 'custom')
+
+    local stats = Jit.stats()
+    assert.is.equal(stats.started, 3)
+    assert.is.equal(stats.completed, 1)
+    assert.is.equal(stats.aborted, 2)
+    assert.are.same(stats.compiled, {['hot.lua:10'] = 1})
+    assert.are.same(stats.reasons, {['NYI: FastFunc next'] = 1, custom = 1})
+    assert.are.same(stats.aborts, {
+      ['cold.lua:6  NYI: FastFunc next'] = 1,
+      ['builtin#7  custom'] = 1,
+    })
+
+    local path = os.tmpname()
+    assert.is.equal(Jit.stop(path), stats)
+    assert.is_nil(attached)
+    local f = io.open(path)
+    local report = f:read('*a')
+    f:close()
+    os.remove(path)
+    assert.is.truthy(report:find('started 3  completed 1  aborted 2', 1, true))
+    assert.is.truthy(report:find('cold.lua:6  NYI: FastFunc next', 1, true))
+
+    package.loaded['jit.util'], package.loaded['jit.vmdef'] = nil, nil
+  end)
+
+  it('should not start without LuaJIT', function()
+    if rawget(_G, 'jit') then return end
+    assert.is_false(Jit.start())
+  end)
+end)
@@ -121,6 +121,56 @@ describe('Observable', function()
       end
       assert.is.equal(num_keys, 4)
     end)
+
+    it('should create slots on first use', function()
+      local o = Observable.new({a = 1, b = 2, c = {d = 3}, e = 4})
+      local t = Observable.unwrap_indexable(o)
+      assert.is.equal(t.a, 1)
+      assert.is.equal(o.a, 1)
+      assert.is.equal(t.a, 1)
+
+      local n = 0
+      Observable.watch(o, 'b', function(v) n = v end)
+      o.b = 5
+      assert.is.equal(n, 5)
+      assert.is_true(Observable.is_observable(t.b))
+
+      o.e = nil
+      assert.is_nil(o.e)
+      assert.is_true(Observable.is_observable(o.c))
+      assert.is.equal(o.c.d, 3)
+    end)
+
+    it('should notify watchers of lazily created slots', function()
+      local o = Observable.new({list = {{name = 'a'}, {name = 'b'}}})
+      local changes = {}
+      Observable.watch(o.list[2], nil, function(v, idx)
+        table.insert(changes, idx)
+      end)
+      o.list[2].name = 'c'
+      o.list[2] = {name = 'd'}
+      assert.are.same(changes, {'name', 'name'})
+      o.list[2].name = 'c'
+
+      local names = {}
+      for i, item in ipairs(o.list) do names[i] = item.name end
+      assert.are.same(names, {'a', 'c'})
+    end)
+
+    it('should keep entries raw when assigned to watched keys', function()
+      local o = Observable.new({})
+      local changes = {}
+      Observable.watch(o, 'list', function(v, idx)
+        if idx then changes[idx] = v.name end
+      end)
+      o.list = {{name = 'a'}, {name = 'b'}}
+      assert.are.same(changes, {'a', 'b'})
+      assert.is.equal(#o.list, 2)
+
+      local t = Observable.unwrap_indexable(o.list)
+      assert.is_nil(getmetatable(t[1]))
+      assert.is_nil(getmetatable(t[2]))
+    end)
   end)
 
   it('should get change notifications with watch()', function()
@@ -271,6 +321,29 @@ describe('Observable', function()
     o.a = 3
   end)
 
+  it('should hold changes of suspended scopes until resumed', function()
+    local o = Observable.new({a = 1, b = 1})
+    local scope, other = {}, {}
+    local changes = {}
+    Observable.watch(o, 'a', function(v) table.insert(changes, 'a' .. v) end,
+      scope)
+    Observable.watch(o, 'b', function(v) table.insert(changes, 'b' .. v) end,
+      other)
+
+    Observable.suspend(scope)
+    assert.is_true(Observable.is_suspended(scope))
+    o.a = 2
+    o.a = 3
+    o.b = 2
+    assert.are.same(changes, {'b2'})
+
+    Observable.resume(scope)
+    assert.is_false(Observable.is_suspended(scope))
+    assert.are.same(changes, {'b2', 'a3'})
+    o.a = 4
+    assert.are.same(changes, {'b2', 'a3', 'a4'})
+  end)
+
   it('should not store [Observable] unless it is a slot', function()
     local o = Observable.new(1)
     assert.has.error(function()
@@ -341,4 +414,175 @@ describe('Observable', function()
     assert.is.equal(Observable.is_observable(store.b), true)
     assert.is.equal(store.c, nil)
   end)
+
+  describe('computed', function()
+    it('should evaluate lazily and only once per change', function()
+      local o = Observable.new({a = 1, b = 2})
+      local calls = 0
+      local sum = Observable.computed(function()
+        calls = calls + 1
+        return o.a + o.b
+      end)
+      assert.is.equal(calls, 0)
+      assert.is.equal(Observable.unwrap(sum), 3)
+      assert.is.equal(Observable.unwrap(sum), 3)
+      assert.is.equal(calls, 1)
+
+      o.a = 10
+      o.b = 20
+      assert.is.equal(calls, 1)
+      assert.is.equal(Observable.unwrap(sum), 30)
+      assert.is.equal(calls, 2)
+    end)
+
+    it('should notify watchers only when the result differs', function()
+      local o = Observable.new({n = 1})
+      local parity = Observable.computed(function()
+        return o.n % 2
+      end)
+      local values = {}
+      Observable.watch(parity, nil, function(v) table.insert(values, v) end)
+
+      o.n = 3
+      o.n = 4
+      o.n = 6
+      o.n = 7
+      assert.is.same(values, {0, 1})
+      assert.is.equal(Observable.unwrap(parity), 1)
+    end)
+
+    it('should track dependencies read on each evaluation', function()
+      local o = Observable.new({flag = true, a = 1, b = 2})
+      local calls = 0
+      local c = Observable.computed(function()
+        calls = calls + 1
+        if o.flag then return o.a end
+        return o.b
+      end)
+      Observable.watch(c, nil, function() end)
+      assert.is.equal(calls, 1)
+
+      o.b = 3
+      assert.is.equal(calls, 1)
+      o.flag = false
+      assert.is.equal(calls, 2)
+      assert.is.equal(Observable.unwrap(c), 3)
+      o.a = 5
+      assert.is.equal(calls, 2)
+    end)
+
+    it('should track iterated tables', function()
+      local o = Observable.new({items = {1, 2, 3, 4}})
+      local even = Observable.computed(function()
+        local t = {}
+        for _, v in ipairs(o.items) do
+          if v % 2 == 0 then table.insert(t, v) end
+        end
+        return t
+      end)
+      local n = 0
+      Observable.watch(even, nil, function(v, idx)
+        if idx == nil then n = n + 1 end
+      end)
+      assert.is.equal(#Observable.unwrap(even), 2)
+
+      o.items[5] = 5
+      assert.is.equal(n, 0)
+      o.items[6] = 6
+      assert.is.equal(n, 1)
+      assert.is.equal(Observable.unwrap(even)[3], 6)
+    end)
+
+    it('should make an existing slot computed', function()
+      local o = Observable.new({a = 1})
+      local slot = Observable.index(o, 'double', true)
+      local values = {}
+      Observable.watch(o, 'double', function(v) table.insert(values, v) end)
+
+      assert.is.equal(Observable.computed(function()
+        return o.a * 2
+      end, o, 'double'), slot)
+      assert.is.equal(o.double, 2)
+      o.a = 2
+      assert.is.same(values, {4})
+    end)
+
+    it('should chain computed values', function()
+      local o = Observable.new({a = 1})
+      local b = Observable.computed(function() return o.a + 1 end, o, 'b')
+      local c = Observable.computed(function() return o.b * 10 end, o, 'c')
+      local values = {}
+      Observable.watch(c, nil, function(v) table.insert(values, v) end)
+      assert.is.equal(o.c, 20)
+
+      o.a = 2
+      assert.is.equal(o.c, 30)
+      assert.is.same(values, {30})
+    end)
+
+    it('should keep the last value once disposed', function()
+      local o = Observable.new({a = 1})
+      local double = Observable.computed(function() return o.a * 2 end)
+      local values = {}
+      Observable.watch(double, nil, function(v) table.insert(values, v) end)
+      o.a = 2
+      Observable.dispose(double)
+      o.a = 3
+      assert.is.same(values, {4})
+      assert.is.equal(Observable.unwrap(double), 4)
+      assert.is.equal(rawget(Observable.index(o, 'a'), '$subscribers'), 0)
+    end)
+
+    it('should rethrow watcher errors with their traceback', function()
+      local o = Observable.new({a = 1, b = 1})
+      local double = Observable.computed(function() return o.a * 2 end)
+      local values = {}
+      Observable.watch(double, nil, function(v) table.insert(values, v) end)
+      Observable.watch(o, 'b', function(v)
+        if v == 0 then error('zero') end
+        o.a = v
+      end)
+
+      local ok, err = pcall(function() o.b = 0 end)
+      assert.is_false(ok)
+      assert.is.truthy(err:find('zero', 1, true))
+      assert.is.truthy(err:find('stack traceback', 1, true))
+
+      o.b = 3
+      assert.is.same(values, {6})
+      assert.is.equal(Observable.unwrap(double), 6)
+    end)
+  end)
+
+  describe('propagation', function()
+    it('should count subscribers but not forwarders', function()
+      local o = Observable.new({a = {b = 1}})
+      local slot = Observable.index(o, 'a')
+      assert.is.equal(slot['$subscribers'], 0)
+      assert.is_false(Observable.interested(Observable.index(o.a, 'b')))
+
+      local f = function() end
+      Observable.watch(o, 'a', f)
+      assert.is.equal(slot['$subscribers'], 1)
+      assert.is_true(Observable.interested(Observable.index(o.a, 'b')))
+
+      Observable.unwatch(o, 'a', f)
+      assert.is.equal(slot['$subscribers'], 0)
+      assert.is_false(Observable.interested(Observable.index(o.a, 'b')))
+    end)
+
+    it('should propagate once a watcher is added higher up', function()
+      local o = Observable.new({a = {b = {c = 1}}})
+      local b = o.a.b
+      b.c = 2
+
+      local changes = {}
+      Observable.watch(o.a, 'b', function(v, idx)
+        table.insert(changes, idx)
+      end)
+      b.c = 3
+      assert.is.same(changes, {'c'})
+      assert.is.equal(o.a.b.c, 3)
+    end)
+  end)
 end)
@@ -0,0 +1,140 @@
+require('core.env')
+local Scheduler = require('core.Scheduler')
+
+
+local function driven(budget)
+  local clock = Scheduler.fake_clock()
+  local frames = 0
+  local s = Scheduler.new({
+    clock = clock,
+    budget = budget,
+    request_frame = function() frames = frames + 1 end,
+  })
+  return s, clock, function() return frames end
+end
+
+
+describe('Scheduler', function()
+  it('should be [Scheduler] instance', function()
+    local s = Scheduler.new()
+    assert.is.equal(getmetatable(s), Scheduler)
+    assert.is_false(Scheduler.is_driven(s))
+  end)
+
+  it('should run posted work in a frame', function()
+    local s, clock, frames = driven(8)
+    local res = {}
+    Scheduler.post(s, function(a, b) table.insert(res, a + b) end, nil, 1, 2)
+    assert.is.equal(frames(), 1)
+    assert.is.equal(Scheduler.pending(s), 1)
+
+    assert.is.equal(Scheduler.frame(s), 0)
+    assert.are.same(res, {3})
+  end)
+
+  it('should split work over frames by budget', function()
+    local s, clock = driven(8)
+    local done = 0
+    Scheduler.post(s, function()
+      for i = 1, 10 do
+        clock.advance(3)
+        done = done + 1
+        coroutine.yield()
+      end
+    end)
+
+    Scheduler.frame(s)
+    assert.is.equal(done, 3)
+    Scheduler.frame(s)
+    assert.is.equal(done, 6)
+    assert.is.equal(Scheduler.drain(s), 2)
+    assert.is.equal(done, 10)
+  end)
+
+  it('should run input before other work', function()
+    local s, clock = driven(8)
+    local order = {}
+    Scheduler.post(s, function() table.insert(order, 'idle') end,
+      Scheduler.IDLE)
+    Scheduler.post(s, function()
+      table.insert(order, 'build')
+      Scheduler.post(s, function() table.insert(order, 'nested') end,
+        Scheduler.INPUT)
+      coroutine.yield()
+      table.insert(order, 'build')
+    end)
+    Scheduler.post(s, function() table.insert(order, 'input') end,
+      Scheduler.INPUT)
+
+    Scheduler.frame(s)
+    assert.are.same(order, {'input', 'build', 'nested', 'build', 'idle'})
+  end)
+
+  it('should run input regardless of budget', function()
+    local s, clock = driven(8)
+    local input, build = 0, 0
+    for i = 1, 3 do
+      Scheduler.post(s, function() clock.advance(10); build = build + 1 end)
+      Scheduler.post(s, function() clock.advance(10); input = input + 1 end,
+        Scheduler.INPUT)
+    end
+
+    Scheduler.frame(s)
+    assert.is.equal(input, 3)
+    assert.is.equal(build, 0)
+    assert.is.equal(Scheduler.pending(s), 3)
+  end)
+
+  it('should finish and cancel tasks', function()
+    local s = driven(8)
+    local n = 0
+    local function count()
+      for i = 1, 5 do n = n + 1; coroutine.yield() end
+    end
+
+    local a = Scheduler.post(s, count)
+    assert.is_false(Scheduler.step(s, a))
+    assert.is.equal(n, 1)
+    Scheduler.finish(s, a)
+    assert.is.equal(n, 5)
+
+    local b = Scheduler.post(s, count)
+    Scheduler.cancel(s, b)
+    Scheduler.frame(s)
+    assert.is.equal(n, 5)
+    assert.is.equal(Scheduler.pending(s), 0)
+  end)
+
+  it('should defer wrapped calls only when driven', function()
+    local res = {}
+    local f = function(v) table.insert(res, v) end
+
+    local direct = Scheduler.wrap(Scheduler.new(), f)
+    direct(1)
+    assert.are.same(res, {1})
+
+    local s = driven(8)
+    local deferred = Scheduler.wrap(s, f)
+    deferred(2)
+    assert.are.same(res, {1})
+    Scheduler.frame(s)
+    assert.are.same(res, {1, 2})
+  end)
+
+  it('should keep running the queue after a failed task', function()
+    local s, clock, frames = driven(8)
+    local n = 0
+    Scheduler.post(s, function() error('failed') end)
+    Scheduler.post(s, function() n = n + 1 end)
+    local requested = frames()
+
+    local ok, err = pcall(Scheduler.frame, s)
+    assert.is_false(ok)
+    assert.is.truthy(err:find('failed', 1, true))
+    assert.is.equal(frames(), requested + 1)
+    assert.is.equal(Scheduler.pending(s), 1)
+
+    assert.is.equal(Scheduler.frame(s), 0)
+    assert.is.equal(n, 1)
+  end)
+end)
@@ -0,0 +1,63 @@
+require('core.env')
+local Observable = require('core.Observable')
+local Snapshot = require('core.Snapshot')
+
+
+describe('Snapshot', function()
+  it('should round trip values', function()
+    local value = {
+      a = 1, b = -2, c = 0.5, d = 'text', e = true, f = false,
+      list = {1, 2, {x = 3}}, big = 2^40, neg = -2^40, small = -1e-9,
+      [10] = 'sparse',
+    }
+    local data = Snapshot.dump(value)
+    assert.are.same(Snapshot.load(data), value)
+    assert.is.equal(Snapshot.load(Snapshot.dump('x')), 'x')
+  end)
+
+  it('should round trip infinities and NaN', function()
+    local data = Snapshot.dump({math.huge, -math.huge, 0 / 0, [math.huge] = 1})
+    local t = Snapshot.load(data)
+    assert.is.equal(t[1], math.huge)
+    assert.is.equal(t[2], -math.huge)
+    assert.is_true(t[3] ~= t[3])
+    assert.is.equal(t[math.huge], 1)
+    assert.is.equal(Snapshot.load(data, {2}), -math.huge)
+  end)
+
+  it('should dump [Observable] state', function()
+    local o = Observable.new({a = 1, b = {2, 3}})
+    o.c = {d = 'e'}
+    local data = Snapshot.dump(o)
+    assert.are.same(Snapshot.load(data), {a = 1, b = {2, 3}, c = {d = 'e'}})
+  end)
+
+  it('should skip unsupported values', function()
+    local value = {1, print, 3, a = print, b = setmetatable({}, {}), c = 'c'}
+    assert.are.same(Snapshot.load(Snapshot.dump(value)), {1, [3] = 3, c = 'c'})
+  end)
+
+  it('should fail on cycles but not on shared tables', function()
+    local shared = {1}
+    assert.are.same(Snapshot.load(Snapshot.dump({shared, shared})), {{1}, {1}})
+
+    local t = {a = {}}
+    t.a.parent = t
+    assert.has_error(function() Snapshot.dump(t) end, 'Cyclic snapshot value')
+    local o = Observable.new({a = {}})
+    o.a.b = o
+    assert.has_error(function() Snapshot.dump(o) end, 'Cyclic snapshot value')
+    assert.are.same(Snapshot.load(Snapshot.dump(shared)), {1})
+  end)
+
+  it('should load subtrees', function()
+    local data = Snapshot.dump({
+      a = {b = {c = 1}}, list = {'x', {y = 'z'}}, d = 2,
+    })
+    assert.are.same(Snapshot.load(data, {'a', 'b'}), {c = 1})
+    assert.are.same(Snapshot.load(data, {'list', 2}), {y = 'z'})
+    assert.is.equal(Snapshot.load(data, {'d'}), 2)
+    assert.is_nil(Snapshot.load(data, {'a', 'x'}))
+    assert.is_nil(Snapshot.load(data, {'d', 'x'}))
+  end)
+end)
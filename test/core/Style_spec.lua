@@ -0,0 +1,84 @@
+require('core.env')
+local platform = require('platform')
+local IndexRecorder = require('core.IndexRecorder')
+local Style = require('core.Style')
+
+
+describe('Style', function()
+  local attr = IndexRecorder.new('attr')
+
+  -- Plans of the headless platform are the properties themselves
+  platform.compile_style = platform.compile_style or function(props)
+    return props
+  end
+
+  it('should convert values', function()
+    assert.is.equal(Style.value(12), 12)
+    assert.is.equal(Style.value('match'), -1)
+    assert.is.equal(Style.value('#102030'), 0xff102030)
+    assert.is.equal(Style.value('#80102030'), 0x80102030)
+    assert.has_error(function() Style.value('large') end)
+  end)
+
+  it('should compile own and owner sheets into one plan', function()
+    local text = {name = 'ui.Text', style = {
+      Text = {text_size = 14, padding = 4},
+    }}
+    local owner = {name = 'components.Card', style = {
+      Text = {text_size = 18, text_color = attr.color},
+      Button = {padding = 8},
+    }}
+
+    local plan = Style.plan(text, owner)
+    assert.are.same(plan.static, {text_size = 18, padding = 4})
+    assert.are.same(plan.dynamic, {
+      {name = 'text_color', attr = 'color', own = false},
+    })
+    assert.is.equal(Style.plan(text, owner), plan)
+    assert.are.same(Style.plan(text).static, {text_size = 14, padding = 4})
+  end)
+
+  it('should reject unknown properties and bindings', function()
+    local text = {name = 'ui.Text', style = {}}
+    assert.has_error(function()
+      Style.plan(text, {name = 'A', style = {Text = {margin = 1}}})
+    end)
+    assert.has_error(function()
+      Style.plan(text, {name = 'B', style = {Text = {padding = attr.a.b}}})
+    end)
+  end)
+
+  it('should replace the plan of a reused element', function()
+    local apply_style, clear_style = platform.apply_style, platform.clear_style
+    local applied, cleared = {}, {}
+    platform.apply_style = function(element, plan)
+      table.insert(applied, plan)
+      for name, value in pairs(plan) do element[name] = value end
+    end
+    platform.clear_style = function(element, names)
+      table.insert(cleared, names)
+      for _, name in ipairs(names) do element[name] = nil end
+    end
+
+    local row = {name = 'ui.Row', style = {Row = {padding = 4}}}
+    local red = {name = 'components.Red', style = {
+      Row = {background_color = '#ff0000'},
+    }}
+    local plain = {name = 'components.Plain', style = {}}
+    local scope = {['$parent'] = {definition = red}}
+    local component = {definition = row, scope = scope, element = {}}
+
+    Style.apply(component)
+    assert.are.same(component.element,
+      {padding = 4, background_color = 0xffff0000})
+    Style.apply(component)
+    assert.is.equal(#applied, 1)
+
+    scope['$parent'] = {definition = plain}
+    Style.apply(component)
+    assert.are.same(cleared, {{'background_color'}})
+    assert.are.same(component.element, {padding = 4})
+
+    platform.apply_style, platform.clear_style = apply_style, clear_style
+  end)
+end)
@@ -0,0 +1,39 @@
+require('core.env')
+local TextBuffer = require('core.TextBuffer')
+
+
+describe('TextBuffer', function()
+  it('should apply edits when the value is needed', function()
+    local b = TextBuffer.new('hello world')
+    TextBuffer.edit(b, 5, 0, ',')
+    TextBuffer.edit(b, 0, 1, 'H')
+    assert.is_true(TextBuffer.pending(b))
+    assert.is.equal(TextBuffer.value(b), 'Hello, world')
+    assert.is_false(TextBuffer.pending(b))
+  end)
+
+  it('should merge typing into one edit', function()
+    local b = TextBuffer.new('ab')
+    for i, c in ipairs({'c', 'd', 'e'}) do
+      TextBuffer.edit(b, 1 + i, 0, c)
+    end
+    -- Backspace, then an IME rewriting the composed word
+    TextBuffer.edit(b, 4, 1, '')
+    TextBuffer.edit(b, 2, 2, 'CDX')
+    assert.is.equal(#b.edits, 1)
+    assert.is.equal(TextBuffer.value(b), 'abCDX')
+  end)
+
+  it('should count offsets in UTF-16 code units', function()
+    assert.is.equal(TextBuffer.units('aé€😀'), 5)
+    local b = TextBuffer.new('é😀b')
+    TextBuffer.edit(b, 3, 0, '€')
+    TextBuffer.edit(b, 0, 1, 'e')
+    assert.is.equal(TextBuffer.value(b), 'e😀€b')
+
+    TextBuffer.edit(b, 4, 0, 'ü')
+    TextBuffer.edit(b, 4, 1, '')
+    TextBuffer.edit(b, 1, 2, '')
+    assert.is.equal(TextBuffer.value(b), 'e€b')
+  end)
+end)
@@ -0,0 +1,85 @@
+require('core.env')
+local Observable = require('core.Observable')
+local Trace = require('core.Trace')
+
+
+describe('Trace', function()
+  it('should record write cascades by level', function()
+    local o = Observable.new({items = {{name = 'a'}}, count = 0})
+    local t = 0
+    Trace.start({clock = function() t = t + 1 return t end})
+
+    local calls = 0
+    Observable.watch(o.items[1], 'name', function(v)
+      calls = calls + 1
+      o.count = o.count + 1
+    end, true)
+    Observable.watch(o, 'count', function() calls = calls + 1 end, true)
+    Observable.watch(o, 'count', function() calls = calls + 1 end, true)
+    o.items[1].name = 'b'
+    assert.is.equal(calls, 3)
+
+    local stats = Trace.stats()
+    assert.is.equal(#stats.writes, 1)
+    local w = stats.writes[1]
+    assert.is.equal(w.label, 'items.1.name')
+    assert.is.truthy(w.origin:find('Trace_spec.lua:', 1, true))
+    assert.is.equal(w.writes, 1)
+    -- The name slot, then the count slot written by its watcher
+    assert.are.same(w.notifies, {1, 1})
+    local watchers = 0
+    for _, e in ipairs(w.events) do
+      if e.watcher then watchers = watchers + 1 end
+    end
+    assert.is.equal(watchers, 3)
+
+    local count
+    for _, s in pairs(stats.slots) do
+      if s.label == 'count' then count = s end
+    end
+    assert.is.equal(count.subscribers, 2)
+    assert.is.equal(count.calls, 2)
+
+    local report = Trace.report()
+    assert.is.truthy(report:find('writes 1  dropped 0', 1, true))
+    assert.is.truthy(report:find('items.1.name', 1, true))
+    local json = Trace.export()
+    assert.is.truthy(json:find('"name":"items.1.name","cat":"write"', 1, true))
+    assert.is.truthy(json:find('"cat":"watcher"', 1, true))
+
+    assert.is.equal(Trace.stop(), stats)
+    o.count = 5
+    assert.is.equal(#stats.writes, 1)
+  end)
+
+  it('should bound the writes kept', function()
+    local o = Observable.new({a = 0})
+    Trace.start({max_writes = 2})
+    for i = 1, 5 do o.a = i end
+    local stats = Trace.stop()
+    assert.is.equal(#stats.writes, 2)
+    assert.is.equal(stats.dropped, 3)
+    assert.is.equal(o.a, 5)
+  end)
+
+  it('should keep the stack of watcher errors', function()
+    local o = Observable.new({a = 0, b = 0, c = 0})
+    Trace.start()
+    local function fail() error('failed watcher') end
+    Observable.watch(o, 'b', function(v) fail() end)
+    Observable.watch(o, 'a', function(v) o.b = v end)
+
+    local ok, err = pcall(function() o.a = 1 end)
+    assert.is_false(ok)
+    assert.is.truthy(err:find('failed watcher', 1, true))
+    local _, tracebacks = err:gsub('stack traceback:', '')
+    assert.is.equal(tracebacks, 1)
+    assert.is.truthy(err:find("in %a* ?[`']?fail'?"))
+
+    -- Later writes start a new cascade
+    o.c = 1
+    local stats = Trace.stop()
+    assert.is.equal(#stats.writes, 2)
+    assert.is.equal(stats.writes[2].level, 0)
+  end)
+end)
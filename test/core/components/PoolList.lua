@@ -0,0 +1,11 @@
+view {
+  ui.Panel { loop = scope.items,
+    component.PoolRow { label = loop.value.name },
+  },
+}
+
+controller {
+  function()
+    scope.items = {{name = 'a'}, {name = 'b'}, {name = 'c'}}
+  end,
+}
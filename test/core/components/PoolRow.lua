@@ -0,0 +1,21 @@
+view {
+  ui.Text { attr.label },
+}
+
+controller {
+  function(loop)
+    scope.built = (scope.built or 0) + 1
+    scope.key = loop.key
+  end,
+
+  [attr.label] = function(v)
+    scope.last = v
+  end,
+
+  ['$pool'] = 2,
+
+  ['$reset'] = function()
+    scope.resets = (scope.resets or 0) + 1
+    scope.last = nil
+  end,
+}
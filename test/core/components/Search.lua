@@ -0,0 +1,10 @@
+view {
+  ui.Edit:query { scope.text, deltas = true },
+  ui.Button:submit { 'Search' },
+}
+
+controller {
+  [id.submit.click] = function()
+    scope.submitted = scope.text
+  end,
+}
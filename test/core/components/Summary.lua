@@ -0,0 +1,14 @@
+local Observable = require('core.Observable')
+
+view {
+  ui.Text { scope.total },
+}
+
+controller {
+  function(source)
+    scope.source = source
+    Observable.computed(function()
+      return source.a + source.b
+    end, scope, 'total')
+  end,
+}
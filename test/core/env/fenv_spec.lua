@@ -0,0 +1,63 @@
+require('core.env')
+
+
+describe('fenv', function()
+  it('should run cloned function in env', function()
+    local f = function() return value end
+    local clone = clonefenv(f, {value = 1})
+    assert.is.equal(clone(), 1)
+    assert.is.equal(clonefenv(f, {value = 2})(), 2)
+  end)
+
+  it('should share upvalues with cloned function', function()
+    local n = 0
+    local f = function() n = n + 1; return n end
+    local clone = clonefenv(f, {})
+    assert.is.equal(clone(), 1)
+    assert.is.equal(f(), 2)
+    assert.is.equal(n, 2)
+  end)
+
+  it('should keep env for closures created by cloned function', function()
+    local f = function() return function() return value end end
+    local inner = clonefenv(f, {value = 1})()
+    assert.is.equal(inner(), 1)
+  end)
+
+  it('should rebind released clones', function()
+    local n = 0
+    local f = function() n = n + 1; return value end
+    local clone = clonefenv(f, {value = 1})
+    releasefenv(clone)
+    local reused = clonefenv(f, {value = 2})
+    assert.is.equal(reused, clone)
+    assert.is.equal(reused(), 2)
+    assert.is.equal(clonefenv(f, {value = 3})(), 3)
+    assert.is.equal(n, 2)
+  end)
+
+  it('should call once in env', function()
+    local f = function(a) return value, a end
+    assert.is.same({callfenv(f, {value = 1}, true, 'x')}, {1, 'x'})
+    assert.is.same({callfenv(f, {value = 2}, true)}, {2, nil})
+    assert.is.equal(callfenv(function() return type end, {}, true), type)
+  end)
+
+  it('should bind env with global fallback', function()
+    local f = function(a, b) return value, type(a), b end
+    local bound = bindfenv(f, {value = 1}, true)
+    assert.is.same({bound('x', 2)}, {1, 'string', 2})
+  end)
+
+  it('should only yield from async functions', function()
+    local f = async(function(a)
+      local b = coroutine.yield(a + value)
+      return b * value
+    end)
+    local bound = bindfenv(f, {value = 2}, true)
+    local t = coroutine.create(bound)
+    assert.is.same({coroutine.resume(t, 1)}, {true, 3})
+    assert.is.same({coroutine.resume(t, 5)}, {true, 10})
+    assert.is.equal(coroutine.status(t), 'dead')
+  end)
+end)
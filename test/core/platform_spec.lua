@@ -0,0 +1,89 @@
+require('core.env')
+local platform = require('platform').set('headless')
+local Scheduler = require('core.Scheduler')
+
+
+describe('platform', function()
+  it('should resume awaiting calls on completion', function()
+    local log = {}
+    local result = platform.run(function(a)
+      table.insert(log, a)
+      assert.is_true(platform.can_await())
+      local data, err = platform.await('r1')
+      table.insert(log, data)
+      table.insert(log, err)
+      return 'done'
+    end, 'start')
+
+    -- Waiting calls return nothing to the host
+    assert.is_nil(result)
+    assert.is_false(platform.can_await())
+    assert.is_true(platform.is_awaiting())
+    assert.are.same(log, {'start'})
+
+    platform.complete('unknown', 'ignored')
+    assert.are.same(log, {'start'})
+
+    platform.complete('r1', 'data', 'warning')
+    assert.are.same(log, {'start', 'data', 'warning'})
+    assert.is_false(platform.is_awaiting())
+  end)
+
+  it('should return results of calls that do not wait', function()
+    local a, b = platform.run(function(x) return x, x * 2 end, 2)
+    assert.is.equal(a, 2)
+    assert.is.equal(b, 4)
+  end)
+
+  it('should keep concurrent calls apart', function()
+    local got = {}
+    for _, id in ipairs({'a', 'b'}) do
+      platform.run(function()
+        got[id] = platform.await(id)
+        -- Calls made while resumed can wait again
+        got[id .. '2'] = platform.run(function() return 'nested' end)
+      end)
+    end
+    platform.complete('b', 2)
+    platform.complete('a', 1)
+    assert.are.same(got, {a = 1, b = 2, a2 = 'nested', b2 = 'nested'})
+  end)
+
+  it('should raise errors of calls with their traceback', function()
+    platform.run(function()
+      platform.await('boom')
+      error('boom')
+    end)
+    local ok, err = pcall(platform.complete, 'boom')
+    assert.is_false(ok)
+    assert.is.truthy(tostring(err):find('boom', 1, true))
+    assert.is.truthy(tostring(err):find('traceback', 1, true))
+  end)
+
+  it('should read in place from coroutines resumed by a call', function()
+    local path = (os.getenv('TMPDIR') or '/tmp') .. '/platform_spec.txt'
+    local f = assert(io.open(path, 'w'))
+    f:write('data')
+    f:close()
+
+    local s = Scheduler.new()
+    local data
+    platform.run(function()
+      local task = Scheduler.post(s, function()
+        assert.is_false(platform.can_await())
+        assert.has_error(function() platform.await('task') end,
+          'Not called from the platform.run coroutine')
+        data = platform.read_file_async(path)
+      end)
+      Scheduler.finish(s, task)
+    end)
+    assert.is.equal(data, 'data')
+    assert.is_false(platform.is_awaiting())
+    platform.flush()
+  end)
+
+  it('should not await outside of run', function()
+    assert.has_error(function() platform.await('x') end,
+      'Not called from platform.run')
+  end)
+end)